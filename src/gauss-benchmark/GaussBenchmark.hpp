@@ -13,6 +13,8 @@ struct BenchmarkContext {
     std::vector<int> bucketSizes;
     int min;
     int max;
+    int k; // ones per column.
+    double c; // ratio of rows to columns.
     bool debugPrints;
 };
 
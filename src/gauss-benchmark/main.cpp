@@ -20,8 +20,8 @@
 #include "Matrix.hpp"
 #include "GaussBenchmark.hpp"
 
-#define K 5
-#define C 1.1244
+#define K 5 // default number of ones per column, the slots per entry of the logger.
+#define C 1.1244 // default ratio of rows to columns.
 
 using std::chrono::high_resolution_clock;
 using std::chrono::duration_cast;
@@ -33,9 +33,9 @@ BenchmarkContext parseArguments(int argc, const char* argv[]);
 std::vector<int> parseBucketSizes(const std::string& bucketSizeStr);
 
 string printTime(high_resolution_clock::time_point t1, high_resolution_clock::time_point t2, int fac, bool debug);
-string runTests(bool isVec, MTL::Device *device, int bits, int testStart, int testEnd, bool debug);
+string runTests(bool isVec, MTL::Device *device, int bits, int testStart, int testEnd, int k, double c, bool debug);
 template<typename T>
-string test(bool isVec, MTL::Device *device, int bits, std::string testName, std::function<void(Matrix<T>, MetalGauss<T> *)> solve, int testStart, int testEnd, bool debug);
+string test(bool isVec, MTL::Device *device, int bits, std::string testName, std::function<void(Matrix<T>, MetalGauss<T> *)> solve, int testStart, int testEnd, int k, double c, bool debug);
 
 
 
@@ -51,7 +51,7 @@ string printTime(high_resolution_clock::time_point t1, high_resolution_clock::ti
 }
 
 template<typename T>
-string test(bool isVec, MTL::Device *device, int bits, std::string testName, std::function<void(Matrix<T>, MetalGauss<T> *)> solve, int testStart, int testEnd, bool debug) {
+string test(bool isVec, MTL::Device *device, int bits, std::string testName, std::function<void(Matrix<T>, MetalGauss<T> *)> solve, int testStart, int testEnd, int k, double c, bool debug) {
     if (debug) {
         std::cout << testName << std::endl;
         std::cout << "----------------------------------------------------------" << std::endl;
@@ -62,7 +62,7 @@ string test(bool isVec, MTL::Device *device, int bits, std::string testName, std
     for (int t = testStart; t <= testEnd; ++t) {
         unsigned int size = 1<<t;
         
-        Matrix<T> m = CreateRandomMatrix<T>(ceil(size * C), size, K, bits);
+        Matrix<T> m = CreateRandomMatrix<T>(ceil(size * c), size, k, bits);
         auto *gauss = new MetalGauss<T>(device, &m, false);
         
         
@@ -90,23 +90,23 @@ string test(bool isVec, MTL::Device *device, int bits, std::string testName, std
 }
 
 template<typename T>
-string runTests(bool isVec, MTL::Device *device, int bits, int testStart, int testEnd, bool debug) {
+string runTests(bool isVec, MTL::Device *device, int bits, int testStart, int testEnd, int k, double c, bool debug) {
     std::ostringstream ss;
     
     ss << "{";
     ss << test(isVec, device, bits, "metal", (std::function<void(Matrix<T>, MetalGauss<T>*)>)([](Matrix<T> m, MetalGauss<T> *gauss) -> void {
         gauss->solve();
-    }), testStart, testEnd, debug);
+    }), testStart, testEnd, k, c, debug);
     
     ss << ", ";// \"no metal\": ";
     ss << test(isVec, device, bits, "no Metal", (std::function<void(Matrix<T>, MetalGauss<T>*)>)([](Matrix<T> m, MetalGauss<T> *gauss) -> void {
         MetalGauss<T>::solve_withoutMetal(&m);
-    }), testStart, testEnd, debug);
+    }), testStart, testEnd, k, c, debug);
     
     ss << ", ";//\"no pivot\": ";
     ss << test(isVec, device, bits, "metal no pivot", (std::function<void(Matrix<T>, MetalGauss<T>*)>)([](Matrix<T> m, MetalGauss<T> *gauss) -> void {
         gauss->solve_noParallelPivoting();
-    }), testStart, testEnd, debug);
+    }), testStart, testEnd, k, c, debug);
     
     ss << "}";
     return ss.str();
@@ -144,7 +144,7 @@ std::vector<int> parseBucketSizes(const std::string& bucketSizeStr) {
 
 
 BenchmarkContext parseArguments(int argc, const char* argv[]) {
-    BenchmarkContext ctx = {{}, -1, -1, false};
+    BenchmarkContext ctx = {{}, -1, -1, K, C, false};
     bool minSet = false, maxSet = false, bucketSizeSet = false;
 
     for (int i = 1; i < argc; ++i) {
@@ -159,6 +159,10 @@ BenchmarkContext parseArguments(int argc, const char* argv[]) {
         } else if (((arg == "-bs") || (arg == "--bucket-size")) && i + 1 < argc) {
             ctx.bucketSizes = parseBucketSizes(argv[++i]);
             bucketSizeSet = true;
+        } else if (((arg == "-k") || (arg == "--slots-per-entry")) && i + 1 < argc) {
+            ctx.k = std::atoi(argv[++i]);
+        } else if (((arg == "-c") || (arg == "--slot-ratio")) && i + 1 < argc) {
+            ctx.c = std::atof(argv[++i]);
         } else if ((arg == "-d") || (arg == "--debug-prints")) {
             ctx.debugPrints = true;
         }
@@ -169,10 +173,16 @@ BenchmarkContext parseArguments(int argc, const char* argv[]) {
         std::cerr << "Usage: " << argv[0] << " [-min|--min] <min_value> "
                           << "[-max|--max] <max_value> "
                           << "[-bs|--bucket-size] <bucket_size1,bucket_size2,...> "
+                          << "[-k|--slots-per-entry <k>] [-c|--slot-ratio <c>] "
                           << "[-d|--debug-prints]" << std::endl;
         exit(EXIT_FAILURE); // Terminate the program
     }
 
+    if (ctx.k < 1 || ctx.c < 1.0) {
+        std::cerr << "Invalid k or c, the matrix needs at least one one per column and as many rows as columns.\n";
+        exit(EXIT_FAILURE);
+    }
+
     std::vector<int> validBucketSizes = {1, 32, 64, 256};
     for (int size : ctx.bucketSizes) {
         if (std::find(validBucketSizes.begin(), validBucketSizes.end(), size) == validBucketSizes.end()) {
@@ -205,24 +215,24 @@ int main(int argc, const char * argv[])
             case 1:
                 printNewTest("Running tests with one int holding, exactly 1 value:", ctx.debugPrints);
                 ss << "\"1bit\": ";
-                ss << runTests<B1>(false, device, 1, ctx.min, ctx.max, ctx.debugPrints);
+                ss << runTests<B1>(false, device, 1, ctx.min, ctx.max, ctx.k, ctx.c, ctx.debugPrints);
                 break;
             case 32:
                 printNewTest("Running tests with one integer holding, exactly 32 values:", ctx.debugPrints);
                 ss << "\"32bit\": ";
-                ss << runTests<B32>(false, device, 32, ctx.min, ctx.max, ctx.debugPrints);
+                ss << runTests<B32>(false, device, 32, ctx.min, ctx.max, ctx.k, ctx.c, ctx.debugPrints);
                 
                 break;
             case 64:
                 printNewTest("Running tests with one vector of 1 long holding, exactly 64 values:", ctx.debugPrints);
                 ss << "\"64bit\": ";
-                ss << runTests<B64>(false, device, 64, ctx.min, ctx.max, ctx.debugPrints);
+                ss << runTests<B64>(false, device, 64, ctx.min, ctx.max, ctx.k, ctx.c, ctx.debugPrints);
                 
                 break;
             case 256:
                 printNewTest("Running tests with one vector of 4 longs holding, exactly 256 values:", ctx.debugPrints);
                 ss << "\"256bit\": ";
-                ss << runTests<B256>(true, device, 256, ctx.min, ctx.max, ctx.debugPrints);
+                ss << runTests<B256>(true, device, 256, ctx.min, ctx.max, ctx.k, ctx.c, ctx.debugPrints);
                 
                 break;
             default:
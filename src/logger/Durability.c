@@ -0,0 +1,96 @@
+//
+//  Durability.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "Durability.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *modeNames[] = {"none", "entry", "batch", "interval"};
+
+int SyncFile(int fd)
+{
+#if defined(__APPLE__)
+    // fsync only hands the data to the drive, F_FULLFSYNC also flushes its cache.
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return 1;
+    }
+    // not supported by every file system.
+    return fsync(fd) == 0;
+#elif defined(__linux__)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+int ParseDurabilityMode(const char *name, DurabilityMode *mode)
+{
+    for (int i = 0; i < (int)(sizeof(modeNames) / sizeof(modeNames[0])); ++i) {
+        if (strcmp(name, modeNames[i]) == 0) {
+            *mode = (DurabilityMode)i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+const char *DurabilityModeName(DurabilityMode mode)
+{
+    return modeNames[mode];
+}
+
+void RecordLatency(LatencyHistogram *histogram, unsigned long long ns)
+{
+    int bucket = 0;
+
+    while (bucket < LATENCY_BUCKETS - 1 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+
+    histogram->count[bucket]++;
+    histogram->total++;
+    histogram->sumNs += ns;
+    if (ns > histogram->maxNs) {
+        histogram->maxNs = ns;
+    }
+}
+
+void PrintLatencyHistogram(const LatencyHistogram *histogram, FILE *out)
+{
+    unsigned long seen = 0;
+    int p50 = -1, p99 = -1;
+
+    if (histogram->total == 0) {
+        fprintf(out, "No latencies recorded.\n");
+        return;
+    }
+
+    fprintf(out, "Latency per entry: %lu entries, mean %llu ns, max %llu ns\n",
+            histogram->total, histogram->sumNs / histogram->total, histogram->maxNs);
+
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+        if (histogram->count[b] == 0) {
+            continue;
+        }
+
+        seen += histogram->count[b];
+        if (p50 == -1 && seen * 2 >= histogram->total) {
+            p50 = b;
+        }
+        if (p99 == -1 && seen * 100 >= histogram->total * 99) {
+            p99 = b;
+        }
+
+        fprintf(out, "  [%12llu ns, %12llu ns): %10lu (%5.1f%%)\n",
+                1ULL << b, 1ULL << (b + 1), histogram->count[b], 100.0 * histogram->count[b] / histogram->total);
+    }
+
+    fprintf(out, "p50 < %llu ns, p99 < %llu ns\n", 1ULL << (p50 + 1), 1ULL << (p99 + 1));
+}
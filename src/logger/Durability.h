@@ -0,0 +1,74 @@
+//
+//  Durability.h
+//  logger
+//  Durability modes of the logger, and the accounting of what they cost per log entry.
+//  In every mode the log file is synced before the key is written, a key on disk never belongs to an entry which is not.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef Durability_h
+#define Durability_h
+
+#include <stdio.h>
+
+#define DEFAULT_BATCH_SIZE 64 // entries per sync, in the batch mode.
+#define DEFAULT_SYNC_INTERVAL_MS 100 // time between syncs, in the interval mode.
+#define LATENCY_BUCKETS 40 // bucket b counts latencies in [2^b, 2^(b+1)) ns, the last one all above.
+
+typedef enum {
+    DURABILITY_NONE, // the key is written after every entry, syncing is left to the OS.
+    DURABILITY_ENTRY, // the log file and the key are synced after every entry.
+    DURABILITY_BATCH, // the log file and the key are synced after every batch of entries.
+    DURABILITY_INTERVAL // the log file and the key are synced, once the interval has passed since the last sync.
+} DurabilityMode;
+
+// log2 histogram of latencies in nano seconds.
+typedef struct {
+    unsigned long count[LATENCY_BUCKETS];
+    unsigned long total;
+    unsigned long long sumNs;
+    unsigned long long maxNs;
+} LatencyHistogram;
+
+/*
+ * Function: SyncFile
+ * ------------------
+ * Forces the written data of the file to the storage device (F_FULLFSYNC on Apple, fdatasync on Linux).
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int SyncFile(int fd);
+
+/*
+ * Function: ParseDurabilityMode
+ * -----------------------------
+ * Parses the mode names none, entry, batch and interval.
+ *
+ * returns: 0 on an unknown name and 1 on success.
+ */
+int ParseDurabilityMode(const char *name, DurabilityMode *mode);
+
+/*
+ * Function: DurabilityModeName
+ * ----------------------------
+ * returns: the name of the mode.
+ */
+const char *DurabilityModeName(DurabilityMode mode);
+
+/*
+ * Function: RecordLatency
+ * -----------------------
+ * Adds a single latency to the histogram.
+ */
+void RecordLatency(LatencyHistogram *histogram, unsigned long long ns);
+
+/*
+ * Function: PrintLatencyHistogram
+ * -------------------------------
+ * Prints the non empty buckets, the mean, the maximum, and the bucket bounds of the median and the 99th percentile.
+ */
+void PrintLatencyHistogram(const LatencyHistogram *histogram, FILE *out);
+
+#endif /* Durability_h */
@@ -0,0 +1,235 @@
+//
+//  Journal.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "Journal.h"
+#include "PseudoRandomPad.h"
+#include "Durability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define JOURNAL_MAGIC 0x4E524A50 // "PJRN"
+
+// record: header | slotCount * (slot index | slot) | body digest | key | key digest
+// the body digest covers the header and the slots, the key digest covers the body digest and the key (SHA-256).
+typedef struct {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t entries;
+} JournalHeader;
+
+#define KEY_RECORD_LEN (KEY_SIZE + DIGEST_LEN)
+
+struct Journal {
+    int fd;
+    char *path;
+    LogFileLayout layout;
+    size_t slotRecordLen; // slot index and slot.
+    off_t tail; // end of the last record.
+    off_t lastKey; // offset of the key of the newest record, -1 if there is none.
+};
+
+Journal *OpenJournal(const char *path, const LogFileLayout *layout)
+{
+    Journal *journal = calloc(1, sizeof(Journal));
+
+    if (journal == NULL) {
+        return NULL;
+    }
+
+    if ((journal->fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) == -1) {
+        perror("ERROR: Failed to open the journal.");
+        free(journal);
+        return NULL;
+    }
+
+    journal->path = strdup(path);
+    journal->layout = *layout;
+    journal->slotRecordLen = sizeof(uint64_t) + layout->logLen;
+    journal->lastKey = -1;
+    return journal;
+}
+
+int JournalAppend(Journal *journal, const JournalSlot *slots, int slotCount, const unsigned char key[KEY_SIZE], unsigned long entries)
+{
+    size_t bodyLen = sizeof(JournalHeader) + slotCount * journal->slotRecordLen;
+    size_t recordLen = bodyLen + DIGEST_LEN + KEY_RECORD_LEN;
+    unsigned char *record = malloc(recordLen);
+    unsigned char zero[KEY_RECORD_LEN] = {0};
+    JournalHeader header = {JOURNAL_MAGIC, (uint32_t)slotCount, entries};
+    unsigned char *p = record;
+
+    if (record == NULL) {
+        return 0;
+    }
+
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for (int i = 0; i < slotCount; ++i) {
+        uint64_t slot = slots[i].slot;
+        memcpy(p, &slot, sizeof(slot));
+        memcpy(p + sizeof(slot), slots[i].data, journal->layout.logLen);
+        p += journal->slotRecordLen;
+    }
+
+    if (Digest(record, bodyLen, p) != 1) {
+        free(record);
+        return 0;
+    }
+    memcpy(p + DIGEST_LEN, key, KEY_SIZE);
+    if (Digest(p, DIGEST_LEN + KEY_SIZE, p + DIGEST_LEN + KEY_SIZE) != 1) {
+        memset(record, 0, recordLen);
+        free(record);
+        return 0;
+    }
+
+    int success = PwriteAll(journal->fd, record, recordLen, journal->tail) == 1 && SyncFile(journal->fd) == 1;
+
+    memset(record, 0, recordLen);
+    free(record);
+
+    if (!success) {
+        perror("ERROR: Failed to append to the journal.");
+        return 0;
+    }
+
+    // the new record is durable, the key of the previous one is not needed anymore. Synced along with the next record.
+    if (journal->lastKey != -1 && PwriteAll(journal->fd, zero, KEY_RECORD_LEN, journal->lastKey) != 1) {
+        perror("ERROR: Failed to erase the previous key of the journal.");
+        return 0;
+    }
+
+    journal->lastKey = journal->tail + bodyLen + DIGEST_LEN;
+    journal->tail += recordLen;
+    return 1;
+}
+
+int JournalReplay(Journal *journal, int logFd, unsigned char key[KEY_SIZE], unsigned long *entries)
+{
+    JournalHeader header;
+    unsigned char check[DIGEST_LEN];
+    unsigned char keyRecord[KEY_RECORD_LEN];
+    off_t offset = 0, lastKey = -1;
+    unsigned long lastEntries = 0;
+    int replayed = 0, keyValid = 0;
+    struct stat st;
+
+    if (fstat(journal->fd, &st) != 0) {
+        return -1;
+    }
+
+    // records are read until the first incomplete one, which has not been synced before the crash.
+    while (offset + (off_t)sizeof(header) <= st.st_size) {
+        if (PreadAll(journal->fd, (unsigned char *)&header, sizeof(header), offset) != 1) {
+            return -1;
+        }
+
+        size_t bodyLen = sizeof(JournalHeader) + (size_t)header.slotCount * journal->slotRecordLen;
+        size_t recordLen = bodyLen + DIGEST_LEN + KEY_RECORD_LEN;
+
+        if (header.magic != JOURNAL_MAGIC || (replayed && header.entries <= lastEntries)
+            || offset + (off_t)recordLen > st.st_size) {
+            break;
+        }
+
+        unsigned char *record = malloc(recordLen);
+        if (record == NULL || PreadAll(journal->fd, record, recordLen, offset) != 1) {
+            free(record);
+            return -1;
+        }
+
+        if (Digest(record, bodyLen, check) != 1 || memcmp(check, record + bodyLen, DIGEST_LEN) != 0) {
+            free(record);
+            break;
+        }
+
+        // redo the slot writes, writing them twice does not change the result.
+        for (uint32_t i = 0; i < header.slotCount; ++i) {
+            uint64_t slot;
+            unsigned char *slotRecord = record + sizeof(header) + i * journal->slotRecordLen;
+            memcpy(&slot, slotRecord, sizeof(slot));
+            if (PwriteSlots(logFd, &journal->layout, slot, 1, slotRecord + sizeof(slot)) != 1) {
+                free(record);
+                return -1;
+            }
+        }
+
+        // only the key of the newest record has not been erased.
+        memcpy(keyRecord, record + bodyLen + DIGEST_LEN, KEY_RECORD_LEN);
+        keyValid = Digest(record + bodyLen, DIGEST_LEN + KEY_SIZE, check) == 1
+                   && memcmp(check, keyRecord + KEY_SIZE, DIGEST_LEN) == 0;
+        if (keyValid) {
+            memcpy(key, keyRecord, KEY_SIZE);
+            lastKey = offset + bodyLen + DIGEST_LEN;
+        }
+
+        memset(record, 0, recordLen);
+        free(record);
+        lastEntries = header.entries;
+        offset += recordLen;
+        replayed = 1;
+    }
+
+    memset(keyRecord, 0, KEY_RECORD_LEN);
+
+    if (!replayed) {
+        return 0;
+    }
+
+    if (!keyValid) {
+        fprintf(stderr, "ERROR: The key of the newest journal record is missing.\n");
+        return -1;
+    }
+
+    journal->tail = offset;
+    journal->lastKey = lastKey;
+    *entries = lastEntries;
+    return 1;
+}
+
+unsigned long JournalSize(Journal *journal)
+{
+    return (unsigned long)journal->tail;
+}
+
+int JournalCheckpoint(Journal *journal)
+{
+    unsigned char zero[KEY_RECORD_LEN] = {0};
+
+    // truncated blocks are not overwritten, therefore the newest key is erased first.
+    if (journal->lastKey != -1 && PwriteAll(journal->fd, zero, KEY_RECORD_LEN, journal->lastKey) != 1) {
+        return 0;
+    }
+
+    if (ftruncate(journal->fd, 0) != 0 || SyncFile(journal->fd) != 1) {
+        perror("ERROR: Failed to empty the journal.");
+        return 0;
+    }
+
+    journal->tail = 0;
+    journal->lastKey = -1;
+    return 1;
+}
+
+void CloseJournal(Journal *journal, int remove)
+{
+    if (journal == NULL) {
+        return;
+    }
+
+    close(journal->fd);
+    if (remove) {
+        unlink(journal->path);
+    }
+    free(journal->path);
+    free(journal);
+}
@@ -0,0 +1,93 @@
+//
+//  Journal.h
+//  logger
+//  Redo journal of the log file. A record holds the new content of every slot changed by a batch of entries, and the key
+//  after the batch. The record is synced before the slots are written to the log file, so that a crash never leaves a
+//  half-applied entry: the journal is replayed on startup instead.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef Journal_h
+#define Journal_h
+
+#include "Crypto.h"
+#include "PIShared.h"
+
+#define JOURNAL_EXTENSION ".journal" // extension of the journal, appended to the log file path.
+#define JOURNAL_CHECKPOINT_SIZE (4 * 1024 * 1024) // journal size after which the log file is synced, and the journal is emptied.
+
+// the new content of a single slot.
+typedef struct {
+    unsigned long slot;
+    unsigned char data[MAX_LOG_LEN]; // logLen bytes of the log file.
+} JournalSlot;
+
+typedef struct Journal Journal;
+
+/*
+ * Function: OpenJournal
+ * ---------------------
+ * Opens (or creates) the journal, an existing journal is kept for JournalReplay.
+ *
+ * layout: layout of the log file, the slots of the records are logLen bytes long.
+ *
+ * returns: the journal or NULL on failure.
+ */
+Journal *OpenJournal(const char *path, const LogFileLayout *layout);
+
+/*
+ * Function: JournalAppend
+ * -----------------------
+ * Appends a record and syncs the journal. Afterwards the key of the previous record is erased, only the newest record
+ * holds a key.
+ *
+ * journal: the journal.
+ * slots: the new content of the changed slots.
+ * slotCount: number of changed slots.
+ * key: the key after the batch.
+ * entries: the number of entries in the log file after the batch.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int JournalAppend(Journal *journal, const JournalSlot *slots, int slotCount, const unsigned char key[KEY_SIZE], unsigned long entries);
+
+/*
+ * Function: JournalReplay
+ * -----------------------
+ * Writes the slots of all complete records into the log file, in their order. The log file is not synced.
+ *
+ * journal: the journal.
+ * logFd: file descriptor of the log file.
+ * key: will hold the key of the newest record.
+ * entries: will hold the number of entries of the newest record.
+ *
+ * returns: -1 on failure, 0 if the journal is empty and 1 if records have been replayed.
+ */
+int JournalReplay(Journal *journal, int logFd, unsigned char key[KEY_SIZE], unsigned long *entries);
+
+/*
+ * Function: JournalSize
+ * ---------------------
+ * returns: the number of bytes of all records since the last checkpoint.
+ */
+unsigned long JournalSize(Journal *journal);
+
+/*
+ * Function: JournalCheckpoint
+ * ---------------------------
+ * Erases the key of the newest record and empties the journal. The log file and the key have to be synced before.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int JournalCheckpoint(Journal *journal);
+
+/*
+ * Function: CloseJournal
+ * ----------------------
+ * Closes the journal. If remove is set the (checkpointed) journal is deleted.
+ */
+void CloseJournal(Journal *journal, int remove);
+
+#endif /* Journal_h */
@@ -0,0 +1,213 @@
+//
+//  KeyStore.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "KeyStore.h"
+#include "PseudoRandomPad.h"
+#include "Durability.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define KEY_STORE_MAGIC 0x534B4950 // "PIKS"
+#define KEY_STORE_VERSION 2
+#define KEY_STORE_VERSION_1_HEADER_LEN 16 // version 1 has no flags, its keys are not known to be resumable.
+
+// slot: header | key | digest of header and key, the rest of the slot is zero.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sequence;
+    uint64_t resumable; // the log file holds no entry behind the key, even after a crash.
+} KeyStoreHeader;
+
+#define SLOT_DATA_LEN (sizeof(KeyStoreHeader) + KEY_SIZE)
+
+struct KeyStore {
+    int fd;
+    int active; // slot holding the newest key, -1 if there is none.
+    int durable; // slot holding the newest synced key, -1 if there is none.
+};
+
+// Prototype decleration
+static int readNewestSlot(int fd, unsigned char key[KEY_SIZE], unsigned long *sequence, int *resumable, int *active);
+static int eraseOlderSlot(KeyStore *keyStore);
+
+KeyStore *CreateKeyStore(const char *path)
+{
+    KeyStore *keyStore = calloc(1, sizeof(KeyStore));
+
+    if (keyStore == NULL) {
+        return NULL;
+    }
+
+    if ((keyStore->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1) {
+        perror("ERROR: Failed to create the key store.");
+        free(keyStore);
+        return NULL;
+    }
+
+    keyStore->active = -1;
+    keyStore->durable = -1;
+    return keyStore;
+}
+
+KeyStore *OpenKeyStore(const char *path, unsigned char key[KEY_SIZE], unsigned long *sequence, int *resumable)
+{
+    KeyStore *keyStore = calloc(1, sizeof(KeyStore));
+
+    if (keyStore == NULL) {
+        return NULL;
+    }
+
+    if ((keyStore->fd = open(path, O_RDWR)) == -1) {
+        perror("ERROR: Failed to open the key store.");
+        free(keyStore);
+        return NULL;
+    }
+
+    if (readNewestSlot(keyStore->fd, key, sequence, resumable, &keyStore->active) != 1) {
+        CloseKeyStore(keyStore);
+        return NULL;
+    }
+    keyStore->durable = keyStore->active;
+
+    return keyStore;
+}
+
+int KeyStoreWrite(KeyStore *keyStore, const unsigned char key[KEY_SIZE], unsigned long sequence, int sync, int resumable)
+{
+    unsigned char slot[KEY_STORE_SLOT_SIZE] = {0};
+    KeyStoreHeader header = {KEY_STORE_MAGIC, KEY_STORE_VERSION, sequence, resumable != 0};
+    // the synced key is never overwritten, before a newer key has been synced.
+    int target = (keyStore->durable != -1 ? keyStore->durable : keyStore->active) == 0 ? 1 : 0;
+
+    memcpy(slot, &header, sizeof(header));
+    memcpy(slot + sizeof(header), key, KEY_SIZE);
+    if (Digest(slot, SLOT_DATA_LEN, slot + SLOT_DATA_LEN) != 1) {
+        memset(slot, 0, sizeof(slot));
+        return 0;
+    }
+
+    int written = PwriteAll(keyStore->fd, slot, KEY_STORE_SLOT_SIZE, (off_t)target * KEY_STORE_SLOT_SIZE) == 1
+                  && (!sync || SyncFile(keyStore->fd) == 1);
+
+    memset(slot, 0, sizeof(slot));
+    if (!written) {
+        perror("ERROR: Failed to write the key store.");
+        return 0;
+    }
+
+    keyStore->active = target;
+    return !sync || eraseOlderSlot(keyStore);
+}
+
+int KeyStoreSync(KeyStore *keyStore)
+{
+    if (SyncFile(keyStore->fd) != 1) {
+        return 0;
+    }
+    return eraseOlderSlot(keyStore);
+}
+
+int ReadKeyStore(const char *path, unsigned char key[KEY_SIZE], unsigned long *sequence)
+{
+    int active, resumable;
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1) {
+        perror("Failed to open the key file.");
+        return 0;
+    }
+
+    int success = readNewestSlot(fd, key, sequence, &resumable, &active);
+    close(fd);
+    return success;
+}
+
+void CloseKeyStore(KeyStore *keyStore)
+{
+    if (keyStore == NULL) {
+        return;
+    }
+
+    close(keyStore->fd);
+    free(keyStore);
+}
+
+// helper function:
+// the newest key has been synced, the other slot is erased. Until then it holds the last synced key.
+static int eraseOlderSlot(KeyStore *keyStore)
+{
+    unsigned char zero[KEY_STORE_SLOT_SIZE] = {0};
+    int older = keyStore->active == 0 ? 1 : 0;
+
+    if (keyStore->active == -1 || keyStore->durable == keyStore->active) {
+        return 1;
+    }
+
+    keyStore->durable = keyStore->active;
+    if (PwriteAll(keyStore->fd, zero, KEY_STORE_SLOT_SIZE, (off_t)older * KEY_STORE_SLOT_SIZE) != 1) {
+        perror("ERROR: Failed to erase the old key.");
+        return 0;
+    }
+    return 1;
+}
+
+// helper function:
+// reads the valid slot with the highest sequence number. A file of KEY_SIZE bytes is a legacy key file.
+static int readNewestSlot(int fd, unsigned char key[KEY_SIZE], unsigned long *sequence, int *resumable, int *active)
+{
+    unsigned char slot[KEY_STORE_SLOT_SIZE];
+    unsigned char check[DIGEST_LEN];
+    KeyStoreHeader header;
+    struct stat st;
+    int found = 0;
+
+    if (fstat(fd, &st) != 0) {
+        return 0;
+    }
+
+    *active = -1;
+    *resumable = 0;
+
+    if (st.st_size == KEY_SIZE) {
+        *sequence = KEY_STORE_NO_SEQUENCE;
+        return PreadAll(fd, key, KEY_SIZE, 0);
+    }
+
+    for (int i = 0; i < 2 && (off_t)(i + 1) * KEY_STORE_SLOT_SIZE <= st.st_size; ++i) {
+        if (PreadAll(fd, slot, KEY_STORE_SLOT_SIZE, (off_t)i * KEY_STORE_SLOT_SIZE) != 1) {
+            return 0;
+        }
+        memcpy(&header, slot, sizeof(header));
+        size_t headerLen = header.version == 1 ? KEY_STORE_VERSION_1_HEADER_LEN : sizeof(header);
+
+        // an erased or torn slot is skipped.
+        if (header.magic != KEY_STORE_MAGIC || (header.version != KEY_STORE_VERSION && header.version != 1)
+            || Digest(slot, headerLen + KEY_SIZE, check) != 1 || memcmp(check, slot + headerLen + KEY_SIZE, DIGEST_LEN) != 0) {
+            continue;
+        }
+
+        if (!found || header.sequence > *sequence) {
+            memcpy(key, slot + headerLen, KEY_SIZE);
+            *sequence = header.sequence;
+            *resumable = header.version == KEY_STORE_VERSION && header.resumable != 0;
+            *active = i;
+            found = 1;
+        }
+    }
+
+    memset(slot, 0, sizeof(slot));
+    if (!found) {
+        fprintf(stderr, "ERROR: The key store does not hold a valid key.\n");
+    }
+    return found;
+}
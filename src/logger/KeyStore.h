@@ -0,0 +1,87 @@
+//
+//  KeyStore.h
+//  logger
+//  Stores the current session key in two alternating slots. Every slot holds the key, the number of entries it belongs
+//  to, whether it can be resumed after a crash, and a checksum. A key update is a single aligned write into the slot, which does not hold the last synced key.
+//  That key is erased only after a newer key has been synced, therefore a torn or lost write never destroys it.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef KeyStore_h
+#define KeyStore_h
+
+#include "Crypto.h"
+
+#define KEY_STORE_SLOT_SIZE 512 // size of a slot, a single sector.
+#define KEY_STORE_NO_SEQUENCE ((unsigned long)-1) // sequence number of a legacy key file, holding only the key.
+
+typedef struct KeyStore KeyStore;
+
+/*
+ * Function: CreateKeyStore
+ * ------------------------
+ * Creates a new, empty key store. An existing file is replaced.
+ *
+ * returns: the key store or NULL on failure.
+ */
+KeyStore *CreateKeyStore(const char *path);
+
+/*
+ * Function: OpenKeyStore
+ * ----------------------
+ * Opens an existing key store, and reads its newest valid key. A legacy key file is converted on the next write.
+ *
+ * path: path of the key store.
+ * key: will hold the newest key.
+ * sequence: will hold its sequence number (the number of entries), KEY_STORE_NO_SEQUENCE for a legacy key file.
+ * resumable: will hold 1, if the key has been written as resumable (see KeyStoreWrite), otherwise 0.
+ *
+ * returns: the key store or NULL on failure.
+ */
+KeyStore *OpenKeyStore(const char *path, unsigned char key[KEY_SIZE], unsigned long *sequence, int *resumable);
+
+/*
+ * Function: KeyStoreWrite
+ * -----------------------
+ * Writes the key into the slot, which does not hold the last synced key. If sync is set, the new slot is synced and the
+ * other one is erased afterwards. Otherwise the write is left to the OS, and the other slot is kept until KeyStoreSync.
+ *
+ * keyStore: the key store.
+ * key: the new key.
+ * sequence: the number of entries the key belongs to.
+ * sync: 1 to sync the new slot.
+ * resumable: 1 if no entry can reach the log file ahead of the next key, so that the log can be resumed with this key
+ *            after a crash.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int KeyStoreWrite(KeyStore *keyStore, const unsigned char key[KEY_SIZE], unsigned long sequence, int sync, int resumable);
+
+/*
+ * Function: KeyStoreSync
+ * ----------------------
+ * Syncs all previous writes, afterwards the slot of the older key is erased.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int KeyStoreSync(KeyStore *keyStore);
+
+/*
+ * Function: ReadKeyStore
+ * ----------------------
+ * Reads the newest valid key of the key store, or of a legacy key file.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int ReadKeyStore(const char *path, unsigned char key[KEY_SIZE], unsigned long *sequence);
+
+/*
+ * Function: CloseKeyStore
+ * -----------------------
+ * Closes the key store.
+ */
+void CloseKeyStore(KeyStore *keyStore);
+
+#endif /* KeyStore_h */
@@ -0,0 +1,394 @@
+//
+//  LogPool.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "LogPool.h"
+#include "PIShared.h"
+#include "PseudoRandomPad.h"
+#include "Durability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// a spare log file, which is ready to be taken.
+typedef struct {
+    unsigned long id;
+    unsigned char masterKey[KEY_SIZE];
+} LogPoolSpare;
+
+struct LogPool {
+    char *directory;
+    char *prefix;
+    LogFileLayout layout;
+    unsigned long n;
+    unsigned long m;
+    int spares; // number of spares, which should be ready.
+    int threads;
+    LogPoolSpare *ready; // ring buffer of the ready spares, the oldest spare is taken first.
+    int readyFirst;
+    int readyCount;
+    unsigned long nextId; // id of the next spare, that will be created.
+    pthread_mutex_t lock; // guards the ring buffer and the flags.
+    pthread_cond_t changed; // signaled after a spare has been created or taken, and on stop.
+    pthread_t thread;
+    int stop;
+    int failed; // the background thread failed to create a spare, and has been stopped.
+};
+
+// Prototype decleration
+static void *logPoolWorker(void *arg);
+static int createSpare(LogPool *pool, unsigned long id, unsigned char masterKey[KEY_SIZE]);
+static void adoptSpares(LogPool *pool);
+static int spareMatches(LogPool *pool, const char *logPath, unsigned char masterKey[KEY_SIZE]);
+static char *sparePath(LogPool *pool, unsigned long id, const char *extension);
+static void pushSpare(LogPool *pool, unsigned long id, unsigned char masterKey[KEY_SIZE]);
+static void returnSpare(LogPool *pool, LogPoolSpare *spare, const char *logPath, const char *keyPath);
+
+LogPool *CreateLogPool(const char *directory, const char *prefix, const LogFileLayout *layout, unsigned long n, unsigned long m, int spares, int threads)
+{
+    if (spares < 1) {
+        fprintf(stderr, "ERROR: The log pool needs at least one spare.\n");
+        return NULL;
+    }
+
+    LogPool *pool = calloc(1, sizeof(LogPool));
+
+    if (pool == NULL || (pool->ready = calloc(spares, sizeof(LogPoolSpare))) == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->directory = strdup(directory);
+    pool->prefix = strdup(prefix);
+    pool->layout = *layout;
+    pool->n = n;
+    pool->m = m;
+    pool->spares = spares;
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->changed, NULL);
+
+    // reuse the spares of a previous run, their pad has been written and synced completely.
+    adoptSpares(pool);
+
+    if (pthread_create(&pool->thread, NULL, logPoolWorker, pool) != 0) {
+        perror("ERROR: Failed to start the log pool thread.");
+        DestroyLogPool(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int LogPoolTake(LogPool *pool, const char *logPath, const char *masterKeyPath, unsigned char masterKey[KEY_SIZE])
+{
+    LogPoolSpare spare;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->readyCount == 0 && !pool->failed) {
+        pthread_cond_wait(&pool->changed, &pool->lock);
+    }
+
+    if (pool->readyCount == 0) {
+        pthread_mutex_unlock(&pool->lock);
+        fprintf(stderr, "ERROR: No spare log file is available.\n");
+        return 0;
+    }
+
+    spare = pool->ready[pool->readyFirst];
+    memset(&pool->ready[pool->readyFirst], 0, sizeof(LogPoolSpare));
+    pool->readyFirst = (pool->readyFirst + 1) % pool->spares;
+    pool->readyCount--;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+
+    char *spareLogPath = sparePath(pool, spare.id, SPARE_EXTENSION);
+    char *spareKeyPath = sparePath(pool, spare.id, SPARE_KEY_EXTENSION);
+    int success = 1;
+
+    // the key is moved first, a log file is never visible without its master key.
+    if (rename(spareKeyPath, masterKeyPath) != 0) {
+        perror("ERROR: Failed to move the spare log file into place.");
+        returnSpare(pool, &spare, spareLogPath, spareKeyPath);
+        success = 0;
+    } else if (rename(spareLogPath, logPath) != 0) {
+        perror("ERROR: Failed to move the spare log file into place.");
+        // move the key back, so the spare stays complete.
+        if (rename(masterKeyPath, spareKeyPath) == 0) {
+            returnSpare(pool, &spare, spareLogPath, spareKeyPath);
+        } else {
+            unlink(masterKeyPath);
+            unlink(spareLogPath);
+        }
+        success = 0;
+    } else {
+        memcpy(masterKey, spare.masterKey, KEY_SIZE);
+    }
+
+    memset(spare.masterKey, 0, KEY_SIZE);
+    free(spareLogPath);
+    free(spareKeyPath);
+
+    return success;
+}
+
+void DestroyLogPool(LogPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->thread) {
+        pthread_join(pool->thread, NULL);
+    }
+
+    memset(pool->ready, 0, pool->spares * sizeof(LogPoolSpare));
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->changed);
+    free(pool->ready);
+    free(pool->directory);
+    free(pool->prefix);
+    free(pool);
+}
+
+// helper function:
+// background thread, creates a new spare whenever less than the requested number is ready.
+static void *logPoolWorker(void *arg)
+{
+    LogPool *pool = arg;
+    unsigned char masterKey[KEY_SIZE];
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        if (pool->readyCount >= pool->spares) {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+            continue;
+        }
+
+        unsigned long id = pool->nextId++;
+        pthread_mutex_unlock(&pool->lock);
+
+        int created = createSpare(pool, id, masterKey);
+
+        pthread_mutex_lock(&pool->lock);
+        if (created != 1) {
+            pool->failed = 1;
+            pthread_cond_broadcast(&pool->changed);
+            break;
+        }
+
+        pushSpare(pool, id, masterKey);
+        memset(masterKey, 0, KEY_SIZE);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// helper function:
+// creates the spare with the given id, the log file is renamed to its final name after the pad is durable.
+static int createSpare(LogPool *pool, unsigned long id, unsigned char masterKey[KEY_SIZE])
+{
+    char *tmpPath = sparePath(pool, id, SPARE_TMP_EXTENSION);
+    char *logPath = sparePath(pool, id, SPARE_EXTENSION);
+    char *keyPath = sparePath(pool, id, SPARE_KEY_EXTENSION);
+    int keyFd = -1, logFd = -1, success = 0;
+
+    if (GenerateMasterKey(masterKey) != 1) {
+        fprintf(stderr, "ERROR: Failed to generate the master key of a spare log file.\n");
+        goto cleanup;
+    }
+
+    if ((keyFd = open(keyPath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1
+        || PwriteAll(keyFd, masterKey, KEY_SIZE, 0) != 1
+        || SyncFile(keyFd) != 1) {
+        perror("ERROR: Failed to write the master key of a spare log file.");
+        goto cleanup;
+    }
+
+    if ((logFd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1
+        || PreallocateLogFile(logFd, (off_t)LogFileSize(&pool->layout, pool->m)) != 1
+        || WriteLogFileHeader(logFd, &pool->layout, pool->n, pool->m, masterKey) != 1
+        || WritePseudoRandomPad(masterKey, logFd, &pool->layout, pool->m, pool->threads) != 1
+        || SyncFile(logFd) != 1) {
+        perror("ERROR: Failed to write the pad of a spare log file.");
+        goto cleanup;
+    }
+
+    if (rename(tmpPath, logPath) != 0) {
+        perror("ERROR: Failed to rename the spare log file.");
+        goto cleanup;
+    }
+    success = 1;
+
+cleanup:
+    if (keyFd != -1) {
+        close(keyFd);
+    }
+    if (logFd != -1) {
+        close(logFd);
+    }
+    if (success != 1) {
+        unlink(tmpPath);
+        unlink(keyPath);
+        memset(masterKey, 0, KEY_SIZE);
+    }
+    free(tmpPath);
+    free(logPath);
+    free(keyPath);
+
+    return success;
+}
+
+// helper function:
+// scans the directory for the spares of a previous run. Incomplete spares, and spares of a different layout are removed.
+static void adoptSpares(LogPool *pool)
+{
+    DIR *dir = opendir(pool->directory);
+    struct dirent *entry;
+    size_t prefixLen = strlen(pool->prefix);
+
+    if (dir == NULL) {
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        // hidden name: .<prefix>.<id>.spare...
+        const char *name = entry->d_name;
+        char *end;
+
+        if (name[0] != '.' || strncmp(name + 1, pool->prefix, prefixLen) != 0 || name[prefixLen + 1] != '.') {
+            continue;
+        }
+
+        unsigned long id = strtoul(name + prefixLen + 2, &end, 10);
+
+        if (end == name + prefixLen + 2 || strncmp(end, SPARE_EXTENSION, strlen(SPARE_EXTENSION)) != 0) {
+            continue;
+        }
+
+        if (id >= pool->nextId) {
+            pool->nextId = id + 1;
+        }
+        char *logPath = sparePath(pool, id, SPARE_EXTENSION);
+        char *tmpPath = sparePath(pool, id, SPARE_TMP_EXTENSION);
+        char *keyPath = sparePath(pool, id, SPARE_KEY_EXTENSION);
+        unsigned char masterKey[KEY_SIZE];
+        struct stat st;
+        int keyFd;
+
+        if (strcmp(end, SPARE_KEY_EXTENSION) == 0) {
+            // a key without its log file is left over from a crash, before the log file has been created.
+            if (access(logPath, F_OK) != 0 && access(tmpPath, F_OK) != 0) {
+                unlink(keyPath);
+            }
+        } else if (strcmp(end, SPARE_EXTENSION) == 0
+                   && pool->readyCount < pool->spares
+                   && stat(logPath, &st) == 0
+                   && st.st_size == (off_t)LogFileSize(&pool->layout, pool->m)
+                   && (keyFd = open(keyPath, O_RDONLY)) != -1) {
+            int keyRead = PreadAll(keyFd, masterKey, KEY_SIZE, 0);
+            close(keyFd);
+
+            if (keyRead == 1 && spareMatches(pool, logPath, masterKey)) {
+                pushSpare(pool, id, masterKey);
+            } else {
+                unlink(logPath);
+                unlink(keyPath);
+            }
+        } else if (strcmp(end, SPARE_EXTENSION) == 0 || strcmp(end, SPARE_TMP_EXTENSION) == 0) {
+            // incomplete, of a different size, or more than needed.
+            unlink(strcmp(end, SPARE_EXTENSION) == 0 ? logPath : tmpPath);
+            unlink(keyPath);
+        }
+
+        memset(masterKey, 0, KEY_SIZE);
+        free(logPath);
+        free(tmpPath);
+        free(keyPath);
+    }
+
+    closedir(dir);
+}
+
+// helper function:
+// checks the header of a spare, it has been created for the same layout and number of entries.
+static int spareMatches(LogPool *pool, const char *logPath, unsigned char masterKey[KEY_SIZE])
+{
+    unsigned char header[LOG_HEADER_LEN];
+    LogFileLayout layout;
+    unsigned long n, m;
+    int fd, decoded;
+
+    if ((fd = open(logPath, O_RDONLY)) == -1) {
+        return 0;
+    }
+    if (PreadAll(fd, header, LOG_HEADER_LEN, 0) != 1) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+
+    decoded = DecodeLogFileHeader(header, masterKey, &layout, &n, &m);
+    if (decoded == 0) {
+        // no header, the spare has the legacy layout.
+        InitLegacyLogFileLayout(&layout);
+        n = pool->n;
+        m = pool->m;
+    }
+
+    return decoded != -1 && layout.messageLen == pool->layout.messageLen && layout.slotsOffset == pool->layout.slotsOffset
+           && layout.payloadOffset == pool->layout.payloadOffset && layout.k == pool->layout.k && n == pool->n && m == pool->m;
+}
+
+// helper function:
+// path of a spare file: <directory>.<prefix>.<id><extension>
+static char *sparePath(LogPool *pool, unsigned long id, const char *extension)
+{
+    size_t size = strlen(pool->directory) + strlen(pool->prefix) + strlen(extension) + 24;
+    char *path = calloc(size, sizeof(char));
+
+    snprintf(path, size, "%s.%s.%lu%s", pool->directory, pool->prefix, id, extension);
+    return path;
+}
+
+// helper function:
+// appends a spare to the ring buffer, the caller holds the lock (or is the only thread).
+static void pushSpare(LogPool *pool, unsigned long id, unsigned char masterKey[KEY_SIZE])
+{
+    LogPoolSpare *spare = &pool->ready[(pool->readyFirst + pool->readyCount) % pool->spares];
+
+    spare->id = id;
+    memcpy(spare->masterKey, masterKey, KEY_SIZE);
+    pool->readyCount++;
+    pthread_cond_broadcast(&pool->changed);
+}
+
+// helper function:
+// puts a spare, which could not be taken, back into the ring buffer. Without room for it, it is removed.
+static void returnSpare(LogPool *pool, LogPoolSpare *spare, const char *logPath, const char *keyPath)
+{
+    pthread_mutex_lock(&pool->lock);
+    if (pool->readyCount < pool->spares) {
+        pushSpare(pool, spare->id, spare->masterKey);
+    } else {
+        unlink(logPath);
+        unlink(keyPath);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
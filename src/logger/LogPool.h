@@ -0,0 +1,64 @@
+//
+//  LogPool.h
+//  logger
+//  Keeps a number of fully padded spare log files ready, each with its own fresh master key.
+//  The spares are created by a background thread, so that a new log file can be swapped in without writing its pad.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef LogPool_h
+#define LogPool_h
+
+#include "Crypto.h"
+#include "PIShared.h"
+
+#define SPARE_EXTENSION ".spare" // extension of a ready spare log file.
+#define SPARE_TMP_EXTENSION ".spare.tmp" // extension of a spare log file, whose pad is not complete yet.
+#define SPARE_KEY_EXTENSION ".spare.key" // extension of the master key of a spare log file.
+
+typedef struct LogPool LogPool;
+
+/*
+ * Function: CreateLogPool
+ * -----------------------
+ * Creates the pool and starts the background thread, which keeps the requested number of spare log files ready.
+ * The spares are stored as hidden files (.<prefix>.<id>.spare) in the log file directory.
+ * Complete spares of a previous run, with the same header, are reused.
+ *
+ * directory: the log file directory (including the trailing '/').
+ * prefix: the log file name prefix.
+ * layout: layout of every spare log file.
+ * n: max number of entries of every spare log file.
+ * m: number of slots of every spare log file.
+ * spares: number of spares which should be ready.
+ * threads: number of threads used to write the pad of a spare.
+ *
+ * returns: the pool or NULL on failure.
+ */
+LogPool *CreateLogPool(const char *directory, const char *prefix, const LogFileLayout *layout, unsigned long n, unsigned long m, int spares, int threads);
+
+/*
+ * Function: LogPoolTake
+ * ---------------------
+ * Takes the oldest ready spare, and moves it and its master key to the given paths.
+ * Blocks only if no spare is ready yet.
+ *
+ * pool: the pool.
+ * logPath: the new path of the log file.
+ * masterKeyPath: the new path of the master key.
+ * masterKey: will hold the master key of the log file.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int LogPoolTake(LogPool *pool, const char *logPath, const char *masterKeyPath, unsigned char masterKey[KEY_SIZE]);
+
+/*
+ * Function: DestroyLogPool
+ * ------------------------
+ * Stops the background thread and frees the pool. Ready spares stay on disk, and will be reused by the next pool.
+ */
+void DestroyLogPool(LogPool *pool);
+
+#endif /* LogPool_h */
@@ -0,0 +1,517 @@
+//
+//  LogServer.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifdef __linux__
+#define _GNU_SOURCE // struct ucred
+#endif
+
+#include "LogServer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#ifdef __APPLE__
+#include <sys/event.h>
+#else
+#include <sys/epoll.h>
+#endif
+
+#define POLL_EVENTS 64 // events taken from the poller per round.
+#define MAX_WAIT_MS 1000 // the stop flag is checked at least this often, a signal may be taken by another thread.
+
+// a connection of the stream socket, or all senders of the datagram socket.
+typedef struct {
+    int fd;
+    pid_t pid; // peer process, 0 for the datagram socket.
+    int eof; // the peer has closed the connection, the buffer is emptied first.
+    int backlog; // the quota has been reached, the client is served in the next round without waiting.
+    unsigned long messages;
+    unsigned long bytes;
+    unsigned long deferred; // rounds in which the quota has been reached.
+    unsigned long truncated; // messages longer than the max log length (split on the stream socket).
+    size_t buffered; // bytes of an incomplete message in the buffer.
+    unsigned char buffer[MAX_MESSAGE_LEN];
+} LogServerClient;
+
+typedef struct {
+    PIContext *ctx;
+    int poller;
+    int listenFd; // stream socket, accepting connections.
+    LogServerClient datagram; // datagram socket.
+    LogServerClient **clients;
+    int clientCount;
+    unsigned long refused; // connections refused, above LOG_SERVER_MAX_CLIENTS.
+    unsigned long maxEntries;
+    unsigned long written;
+    int dirty; // entries have been added since the last flush.
+    int stop;
+    int failed;
+} LogServer;
+
+static volatile sig_atomic_t stopRequested = 0;
+static volatile sig_atomic_t statsRequested = 0;
+
+// Prototype decleration
+static int createSocket(const char *path, int type);
+static void serveStream(LogServer *server, LogServerClient *client);
+static void serveDatagram(LogServer *server, LogServerClient *client);
+static void acceptClients(LogServer *server);
+static void closeClient(LogServer *server, LogServerClient *client);
+static void addMessage(LogServer *server, LogServerClient *client, unsigned char *message, size_t length);
+static void printClientStats(const char *state, LogServerClient *client);
+static void printAllStats(LogServer *server);
+static pid_t peerPid(int fd);
+static void handleSignal(int signal);
+static int pollerCreate(void);
+static int pollerAdd(int poller, int fd, void *data);
+static int pollerDelete(int poller, int fd);
+static int pollerWait(int poller, void **ready, int maxReady, int timeoutMs);
+
+int RunLogServer(PIContext *ctx, const char *socketPath, unsigned long maxEntries, unsigned long *written)
+{
+    LogServer server = {0};
+    struct sigaction action = {0};
+    void *ready[POLL_EVENTS];
+    char datagramPath[strlen(socketPath) + strlen(LOG_SERVER_DGRAM_EXTENSION) + 1];
+
+    strcpy(datagramPath, socketPath);
+    strcat(datagramPath, LOG_SERVER_DGRAM_EXTENSION);
+
+    *written = 0;
+    server.ctx = ctx;
+    server.maxEntries = maxEntries;
+    server.listenFd = -1;
+    server.datagram.fd = -1;
+
+    // no SA_RESTART, the signals interrupt the poller.
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGUSR1, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((server.poller = pollerCreate()) == -1
+        || (server.listenFd = createSocket(socketPath, SOCK_STREAM)) == -1
+        || (server.datagram.fd = createSocket(datagramPath, SOCK_DGRAM)) == -1
+        || listen(server.listenFd, SOMAXCONN) != 0
+        || pollerAdd(server.poller, server.listenFd, &server.listenFd) != 1
+        || pollerAdd(server.poller, server.datagram.fd, &server.datagram) != 1) {
+        perror("ERROR: Failed to create the log server sockets.");
+        server.failed = 1;
+    } else {
+        printf("INFO: Listening on %s (stream) and %s (datagram).\n", socketPath, datagramPath);
+    }
+
+    while (!server.failed && !server.stop && !stopRequested) {
+        int backlog = server.datagram.backlog;
+        for (int i = 0; i < server.clientCount && !backlog; ++i) {
+            backlog = server.clients[i]->backlog;
+        }
+
+        // the pending entries are flushed once the sockets are idle, a packed entry once it is due.
+        int timeoutMs = backlog ? 0 : server.dirty ? LOG_SERVER_IDLE_MS : MAX_WAIT_MS;
+        long packRemaining = ctx->packer != NULL ? PackerRemainingMs(ctx->packer) : -1;
+        if (packRemaining >= 0 && packRemaining < timeoutMs) {
+            timeoutMs = (int)packRemaining;
+        }
+        int count = pollerWait(server.poller, ready, POLL_EVENTS, timeoutMs);
+
+        if (count == -1 && errno != EINTR) {
+            perror("ERROR: Failed to wait for the log server sockets.");
+            server.failed = 1;
+            break;
+        }
+
+        if (statsRequested) {
+            statsRequested = 0;
+            printAllStats(&server);
+        }
+
+        if (ctx->packer != NULL && PackerRemainingMs(ctx->packer) == 0) {
+            if (FlushLogMessages(ctx) != 1) {
+                server.failed = 1;
+                break;
+            }
+            server.dirty = 1;
+        }
+        if (count == 0 && !backlog && server.dirty) {
+            if (FlushLogEntries(ctx) != 1) {
+                server.failed = 1;
+                break;
+            }
+            server.dirty = 0;
+        }
+
+        for (int i = 0; i < count && !server.stop; ++i) {
+            if (ready[i] == &server.listenFd) {
+                acceptClients(&server);
+            } else {
+                ((LogServerClient *)ready[i])->backlog = 1;
+            }
+        }
+
+        // ready clients and the clients which have been held back are served in the same order, every round.
+        if (server.datagram.backlog && !server.stop) {
+            serveDatagram(&server, &server.datagram);
+        }
+        for (int i = 0; i < server.clientCount && !server.stop; ++i) {
+            LogServerClient *client = server.clients[i];
+
+            if (client->backlog) {
+                serveStream(&server, client);
+            }
+            if (client->fd == -1) {
+                free(client);
+                server.clients[i--] = server.clients[--server.clientCount];
+            }
+        }
+    }
+
+    printAllStats(&server);
+    for (int i = 0; i < server.clientCount; ++i) {
+        close(server.clients[i]->fd);
+        memset(server.clients[i], 0, sizeof(LogServerClient));
+        free(server.clients[i]);
+    }
+    free(server.clients);
+    if (server.listenFd != -1) {
+        close(server.listenFd);
+        unlink(socketPath);
+    }
+    if (server.datagram.fd != -1) {
+        close(server.datagram.fd);
+        unlink(datagramPath);
+    }
+    if (server.poller != -1) {
+        close(server.poller);
+    }
+    memset(server.datagram.buffer, 0, sizeof(server.datagram.buffer));
+
+    *written = server.written;
+    return !server.failed;
+}
+
+// helper function:
+// binds a non-blocking socket of the given type to the path. A stale socket of a previous run is replaced.
+static int createSocket(const char *path, int type)
+{
+    struct sockaddr_un address = {0};
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "ERROR: The socket path is too long: %s\n", path);
+        return -1;
+    }
+
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if ((fd = socket(AF_UNIX, type, 0)) == -1) {
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// helper function:
+// takes up to LOG_SERVER_CLIENT_QUOTA newline separated messages of a connection. A message longer than the max log
+// length is split, and the last message is taken without a newline, like fgets does for the log file.
+static void serveStream(LogServer *server, LogServerClient *client)
+{
+    size_t lineLen = (size_t)server->ctx->layout.messageLen - 1;
+    int taken = 0;
+
+    while (taken < LOG_SERVER_CLIENT_QUOTA && !server->stop) {
+        unsigned char *newline = memchr(client->buffer, '\n', client->buffered);
+
+        if (newline != NULL || client->buffered == lineLen || (client->eof && client->buffered > 0)) {
+            size_t length = newline != NULL ? (size_t)(newline - client->buffer) : client->buffered;
+            size_t consumed = newline != NULL ? length + 1 : length;
+
+            if (newline == NULL && !client->eof) {
+                client->truncated++;
+            }
+            addMessage(server, client, client->buffer, length);
+            memmove(client->buffer, client->buffer + consumed, client->buffered - consumed);
+            client->buffered -= consumed;
+            taken++;
+            continue;
+        }
+
+        if (client->eof) {
+            closeClient(server, client);
+            return;
+        }
+
+        ssize_t received = read(client->fd, client->buffer + client->buffered, lineLen - client->buffered);
+
+        if (received > 0) {
+            client->buffered += received;
+        } else if (received == 0) {
+            client->eof = 1;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            client->backlog = 0;
+            return;
+        } else if (errno != EINTR) {
+            closeClient(server, client);
+            return;
+        }
+    }
+
+    // more messages may be waiting, the client is served again in the next round.
+    client->backlog = 1;
+    client->deferred++;
+}
+
+// helper function:
+// takes up to LOG_SERVER_CLIENT_QUOTA datagrams, a datagram longer than the max log length is truncated.
+static void serveDatagram(LogServer *server, LogServerClient *client)
+{
+    struct iovec iov = {client->buffer, (size_t)server->ctx->layout.messageLen};
+    struct msghdr message = {0};
+    int taken = 0;
+
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    while (taken < LOG_SERVER_CLIENT_QUOTA && !server->stop) {
+        message.msg_flags = 0;
+        ssize_t received = recvmsg(client->fd, &message, 0);
+
+        if (received == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                client->backlog = 0;
+                return;
+            }
+            if (errno != EINTR) {
+                perror("ERROR: Failed to receive a datagram.");
+                server->failed = 1;
+                server->stop = 1;
+                return;
+            }
+            continue;
+        }
+
+        if (message.msg_flags & MSG_TRUNC) {
+            client->truncated++;
+        }
+        addMessage(server, client, client->buffer, (size_t)received);
+        taken++;
+    }
+
+    client->backlog = 1;
+    client->deferred++;
+}
+
+// helper function:
+// accepts all pending connections.
+static void acceptClients(LogServer *server)
+{
+    int fd;
+
+    while ((fd = accept(server->listenFd, NULL, NULL)) != -1) {
+        LogServerClient *client = NULL;
+
+        if (server->clientCount >= LOG_SERVER_MAX_CLIENTS || fcntl(fd, F_SETFL, O_NONBLOCK) != 0
+            || (client = calloc(1, sizeof(LogServerClient))) == NULL) {
+            server->refused++;
+            close(fd);
+            continue;
+        }
+
+        LogServerClient **clients = realloc(server->clients, (server->clientCount + 1) * sizeof(LogServerClient *));
+        if (clients == NULL || pollerAdd(server->poller, fd, client) != 1) {
+            if (clients != NULL) {
+                server->clients = clients;
+            }
+            server->refused++;
+            free(client);
+            close(fd);
+            continue;
+        }
+
+        client->fd = fd;
+        client->pid = peerPid(fd);
+        client->backlog = 1;
+        server->clients = clients;
+        server->clients[server->clientCount++] = client;
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("ERROR: Failed to accept a connection.");
+    }
+}
+
+// helper function:
+// closes the connection, the client is freed by the event loop.
+static void closeClient(LogServer *server, LogServerClient *client)
+{
+    printClientStats("disconnected", client);
+    pollerDelete(server->poller, client->fd);
+    close(client->fd);
+    memset(client->buffer, 0, sizeof(client->buffer));
+    client->fd = -1;
+    client->backlog = 0;
+}
+
+// helper function:
+// adds the message as a log entry, or packs it (AddLogMessage).
+static void addMessage(LogServer *server, LogServerClient *client, unsigned char *message, size_t length)
+{
+    if (server->written >= server->maxEntries) {
+        server->stop = 1;
+        return;
+    }
+
+    if (AddLogMessage(server->ctx, message, (int)length) != 1) {
+        server->failed = 1;
+        server->stop = 1;
+        return;
+    }
+
+    client->messages++;
+    client->bytes += length;
+    server->written++;
+    server->dirty = 1;
+
+    if (server->written >= server->maxEntries) {
+        server->stop = 1;
+    }
+}
+
+// helper function:
+// prints the counters of a client.
+static void printClientStats(const char *state, LogServerClient *client)
+{
+    if (client->pid != 0) {
+        printf("INFO: Client %d %s: ", (int)client->pid, state);
+    } else {
+        printf("INFO: Datagram socket %s: ", state);
+    }
+    printf("%lu messages, %lu bytes, deferred %lu times, %lu truncated.\n",
+           client->messages, client->bytes, client->deferred, client->truncated);
+}
+
+// helper function:
+// prints the counters of all clients.
+static void printAllStats(LogServer *server)
+{
+    printf("INFO: %lu messages written, %d clients connected, %lu refused.\n", server->written, server->clientCount, server->refused);
+    printClientStats("open", &server->datagram);
+    for (int i = 0; i < server->clientCount; ++i) {
+        printClientStats("connected", server->clients[i]);
+    }
+    fflush(stdout);
+}
+
+// helper function:
+// pid of the process on the other end of the connection, 0 if it is unknown.
+static pid_t peerPid(int fd)
+{
+#ifdef __APPLE__
+    pid_t pid;
+    socklen_t length = sizeof(pid);
+    return getsockopt(fd, SOL_LOCAL, LOCAL_PEERPID, &pid, &length) == 0 ? pid : 0;
+#elif defined(SO_PEERCRED)
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 ? credentials.pid : 0;
+#else
+    return 0;
+#endif
+}
+
+// helper function:
+// SIGINT and SIGTERM stop the server, SIGUSR1 prints the statistics.
+static void handleSignal(int signal)
+{
+    if (signal == SIGUSR1) {
+        statsRequested = 1;
+    } else {
+        stopRequested = 1;
+    }
+}
+
+// helper function:
+// creates the poller, kqueue on Apple and epoll elsewhere.
+static int pollerCreate(void)
+{
+#ifdef __APPLE__
+    return kqueue();
+#else
+    return epoll_create1(0);
+#endif
+}
+
+// helper function:
+// watches the file descriptor for reading (level triggered), data is returned by pollerWait.
+static int pollerAdd(int poller, int fd, void *data)
+{
+#ifdef __APPLE__
+    struct kevent event;
+    EV_SET(&event, fd, EVFILT_READ, EV_ADD, 0, 0, data);
+    return kevent(poller, &event, 1, NULL, 0, NULL) == 0;
+#else
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.ptr = data;
+    return epoll_ctl(poller, EPOLL_CTL_ADD, fd, &event) == 0;
+#endif
+}
+
+// helper function:
+// stops watching the file descriptor.
+static int pollerDelete(int poller, int fd)
+{
+#ifdef __APPLE__
+    struct kevent event;
+    EV_SET(&event, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    return kevent(poller, &event, 1, NULL, 0, NULL) == 0;
+#else
+    return epoll_ctl(poller, EPOLL_CTL_DEL, fd, NULL) == 0;
+#endif
+}
+
+// helper function:
+// waits for readable file descriptors, -1 waits without a timeout. returns the number of ready descriptors.
+static int pollerWait(int poller, void **ready, int maxReady, int timeoutMs)
+{
+#ifdef __APPLE__
+    struct kevent events[POLL_EVENTS];
+    struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    int count = kevent(poller, NULL, 0, events, maxReady < POLL_EVENTS ? maxReady : POLL_EVENTS, timeoutMs < 0 ? NULL : &timeout);
+
+    for (int i = 0; i < count; ++i) {
+        ready[i] = events[i].udata;
+    }
+#else
+    struct epoll_event events[POLL_EVENTS];
+    int count = epoll_wait(poller, events, maxReady < POLL_EVENTS ? maxReady : POLL_EVENTS, timeoutMs);
+
+    for (int i = 0; i < count; ++i) {
+        ready[i] = events[i].data.ptr;
+    }
+#endif
+    return count;
+}
@@ -0,0 +1,41 @@
+//
+//  LogServer.h
+//  logger
+//  Long-running logger, which accepts log messages of many local processes over UNIX domain sockets, and writes them
+//  as the single owner of the PIContext. A stream socket takes newline separated messages (like the log file of the
+//  CLI), a datagram socket takes one message per datagram. The sockets are served by a single event loop (epoll on
+//  Linux, kqueue on Apple). Every client is served for a limited number of messages per round, a producer which
+//  sends faster than the log file is written is held back by its full socket buffer.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef LogServer_h
+#define LogServer_h
+
+#include "PI.h"
+
+#define LOG_SERVER_DGRAM_EXTENSION ".dgram" // extension of the datagram socket, appended to the socket path.
+#define LOG_SERVER_CLIENT_QUOTA 16 // messages taken from a single client per round, before the other clients are served.
+#define LOG_SERVER_MAX_CLIENTS 1024 // connections above are refused.
+#define LOG_SERVER_IDLE_MS 50 // idle time, after which the pending entries are made durable.
+
+/*
+ * Function: RunLogServer
+ * ----------------------
+ * Creates the sockets and adds every received message as a log entry, until SIGINT or SIGTERM is received, maxEntries
+ * entries have been added or an entry can not be added. SIGUSR1 prints the statistics of all clients: the number of
+ * messages, and how often the client has been held back (deferred), because it had more messages than its quota.
+ * The log file (or the current segment) has to be initialized.
+ *
+ * ctx: Logger Context.
+ * socketPath: path of the stream socket, the datagram socket is created next to it (LOG_SERVER_DGRAM_EXTENSION).
+ * maxEntries: maximum number of messages to add.
+ * written: will hold the number of added messages (entries, unless they are packed), also on failure.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int RunLogServer(PIContext *ctx, const char *socketPath, unsigned long maxEntries, unsigned long *written);
+
+#endif /* LogServer_h */
@@ -0,0 +1,429 @@
+//
+//  LogStream.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "LogStream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// a line read from the input, or a packed entry.
+typedef struct {
+    int length;
+    unsigned char data[MAX_MESSAGE_LEN];
+} StreamLine;
+
+// a prepared entry, or the marker that the current segment is full.
+typedef struct {
+    int rollOver; // the next entries need the key of the next segment.
+    PreparedLogEntry entry;
+} StreamEntry;
+
+// ring buffer of fixed size items.
+typedef struct {
+    unsigned char *items;
+    size_t itemSize;
+    int capacity;
+    int first;
+    int count;
+    int closed; // no more items will be pushed.
+} StreamQueue;
+
+typedef struct {
+    PIContext *ctx;
+    FILE *input;
+    unsigned long maxEntries;
+    StreamQueue lines; // reader -> prepare thread
+    StreamQueue entries; // prepare thread -> commit (calling) thread
+    pthread_mutex_t lock; // guards both queues, the key handoff and the flag.
+    pthread_cond_t changed; // signaled after every push, pop, close, handoff and on abort.
+    unsigned char key[KEY_SIZE]; // the key of the next segment, handed over to the prepare thread after a roll over.
+    unsigned long entriesLeft; // room in the current log file, for the prepare thread.
+    int m;
+    int keyReady;
+    int aborted; // a stage failed, all stages stop.
+} LogStream;
+
+// Prototype decleration
+static void *readerWorker(void *arg);
+static int submitLine(LogStream *stream, MessagePacker *packer, const unsigned char *data, size_t length, unsigned long *count);
+static int submitPacked(LogStream *stream, MessagePacker *packer);
+static void *prepareWorker(void *arg);
+static int createQueue(StreamQueue *queue, size_t itemSize, int capacity);
+static void destroyQueue(StreamQueue *queue);
+static int queuePush(LogStream *stream, StreamQueue *queue, const void *item);
+static int queuePop(LogStream *stream, StreamQueue *queue, void *item);
+static void queueClose(LogStream *stream, StreamQueue *queue);
+static void abortStream(LogStream *stream);
+
+int StreamLogEntries(PIContext *ctx, FILE *input, unsigned long maxEntries, int queueDepth, unsigned long *written)
+{
+    LogStream stream = {0};
+    StreamEntry entry;
+    pthread_t reader, preparer;
+    struct timespec start, end;
+    int started = 0;
+
+    *written = 0;
+    stream.ctx = ctx;
+    stream.input = input;
+    stream.maxEntries = maxEntries;
+    memcpy(stream.key, ctx->sessionKey, KEY_SIZE);
+    stream.entriesLeft = ctx->entries < ctx->maxEntries ? ctx->maxEntries - ctx->entries : 0;
+    stream.m = ctx->m;
+
+    if (createQueue(&stream.lines, sizeof(StreamLine), queueDepth) != 1
+        || createQueue(&stream.entries, sizeof(StreamEntry), queueDepth) != 1) {
+        perror("ERROR: Failed to allocate the stream queues.");
+        destroyQueue(&stream.lines);
+        return 0;
+    }
+    pthread_mutex_init(&stream.lock, NULL);
+    pthread_cond_init(&stream.changed, NULL);
+
+    if (pthread_create(&reader, NULL, readerWorker, &stream) != 0) {
+        perror("ERROR: Failed to start the reader thread.");
+        abortStream(&stream);
+    } else {
+        started++;
+        if (pthread_create(&preparer, NULL, prepareWorker, &stream) != 0) {
+            perror("ERROR: Failed to start the prepare thread.");
+            abortStream(&stream);
+        } else {
+            started++;
+        }
+    }
+
+    // the calling thread writes the entries in the order they have been prepared.
+    while (queuePop(&stream, &stream.entries, &entry)) {
+        if (entry.rollOver) {
+            if (RollOverLogFile(ctx) != 1) {
+                abortStream(&stream);
+                break;
+            }
+
+            pthread_mutex_lock(&stream.lock);
+            memcpy(stream.key, ctx->sessionKey, KEY_SIZE);
+            stream.entriesLeft = ctx->maxEntries - ctx->entries;
+            stream.m = ctx->m;
+            stream.keyReady = 1;
+            pthread_cond_broadcast(&stream.changed);
+            pthread_mutex_unlock(&stream.lock);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (CommitLogEntry(ctx, &entry.entry) != 1) {
+            abortStream(&stream);
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        RecordLatency(&ctx->latency, (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec);
+        (*written)++;
+    }
+
+    // the queues are closed and empty, or a stage has aborted the stream.
+    if (started > 0) {
+        pthread_join(reader, NULL);
+    }
+    if (started > 1) {
+        pthread_join(preparer, NULL);
+    }
+    int success = !stream.aborted;
+
+    memset(&entry, 0, sizeof(entry));
+    memset(stream.key, 0, KEY_SIZE);
+    pthread_mutex_destroy(&stream.lock);
+    pthread_cond_destroy(&stream.changed);
+    destroyQueue(&stream.lines);
+    destroyQueue(&stream.entries);
+
+    return success;
+}
+
+// helper function:
+// reads the input line by line (like fgets did in the previous readLogs: a line longer than the max log length is split),
+// and passes the lines, or the packed entries in the packed mode, to the prepare thread. A partially packed entry is
+// passed on once its timeout has passed, also while no more input arrives.
+static void *readerWorker(void *arg)
+{
+    LogStream *stream = arg;
+    MessagePacker packer;
+    unsigned char buffer[MAX_MESSAGE_LEN];
+    size_t buffered = 0;
+    size_t lineLen = (size_t)stream->ctx->layout.messageLen - 1; // the longest line, like fgets with the message len.
+    unsigned long count = 0; // lines, packed or not.
+    int fd = fileno(stream->input), eof = 0, success = 1;
+    int packed = stream->ctx->packer != NULL;
+
+    InitMessagePacker(&packer, stream->ctx->layout.messageLen, packed ? stream->ctx->packer->timeoutMs : 0);
+
+    while (count < stream->maxEntries) {
+        unsigned char *newline = memchr(buffer, '\n', buffered);
+
+        if (newline != NULL || buffered == lineLen || (eof && buffered > 0)) {
+            size_t length = newline != NULL ? (size_t)(newline - buffer) : buffered;
+            size_t consumed = newline != NULL ? length + 1 : length;
+
+            if ((success = submitLine(stream, packed ? &packer : NULL, buffer, length, &count)) != 1) {
+                break;
+            }
+            memmove(buffer, buffer + consumed, buffered - consumed);
+            buffered -= consumed;
+            continue;
+        }
+
+        if (eof) {
+            break;
+        }
+
+        // wait for more input no longer than the packed entry may wait.
+        long remaining = PackerRemainingMs(&packer);
+        if (remaining >= 0) {
+            struct pollfd input = {fd, POLLIN, 0};
+
+            if (remaining == 0 || poll(&input, 1, (int)remaining) == 0) {
+                if ((success = submitPacked(stream, &packer)) != 1) {
+                    break;
+                }
+                continue;
+            }
+        }
+
+        ssize_t received = read(fd, buffer + buffered, lineLen - buffered);
+
+        if (received > 0) {
+            buffered += received;
+        } else if (received == 0) {
+            eof = 1;
+        } else if (errno != EINTR) {
+            perror("ERROR: Failed to read the logs.");
+            abortStream(stream);
+            success = 0;
+            break;
+        }
+    }
+
+    if (success) {
+        submitPacked(stream, &packer);
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    ClearMessagePacker(&packer);
+    queueClose(stream, &stream->lines);
+    return NULL;
+}
+
+// helper function:
+// passes the line to the prepare thread, in the packed mode it is appended to the packed entry instead.
+static int submitLine(LogStream *stream, MessagePacker *packer, const unsigned char *data, size_t length, unsigned long *count)
+{
+    StreamLine line;
+
+    if (packer != NULL) {
+        if (PackerAppend(packer, data, length) == 1) {
+            (*count)++;
+            return PackerRemainingMs(packer) == 0 ? submitPacked(stream, packer) : 1;
+        }
+
+        // the entry is full, the line starts the next one. A line too long to be packed is passed on its own.
+        if (submitPacked(stream, packer) != 1) {
+            return 0;
+        }
+        if (PackerAppend(packer, data, length) == 1) {
+            (*count)++;
+            return 1;
+        }
+    }
+
+    line.length = (int)PlainMessageLength(data, length);
+    memcpy(line.data, data, line.length);
+    int success = queuePush(stream, &stream->lines, &line);
+    memset(&line, 0, sizeof(line));
+
+    if (success == 1) {
+        (*count)++;
+    }
+    return success;
+}
+
+// helper function:
+// passes the packed entry to the prepare thread, if there is one.
+static int submitPacked(LogStream *stream, MessagePacker *packer)
+{
+    StreamLine line;
+    const unsigned char *payload = PackerTake(packer, &line.length);
+
+    if (payload == NULL) {
+        return 1;
+    }
+
+    memcpy(line.data, payload, line.length);
+    int success = queuePush(stream, &stream->lines, &line);
+    memset(&line, 0, sizeof(line));
+    return success;
+}
+
+// helper function:
+// encrypts the lines with its own copy of the key chain, ahead of the commit thread. At the end of a segment, it waits
+// for the commit thread to roll over, and continues with the key of the next segment.
+static void *prepareWorker(void *arg)
+{
+    LogStream *stream = arg;
+    StreamLine line;
+    StreamEntry entry = {0};
+    unsigned char key[KEY_SIZE];
+    unsigned long entriesLeft;
+    int m;
+
+    pthread_mutex_lock(&stream->lock);
+    memcpy(key, stream->key, KEY_SIZE);
+    entriesLeft = stream->entriesLeft;
+    m = stream->m;
+    pthread_mutex_unlock(&stream->lock);
+
+    while (queuePop(stream, &stream->lines, &line)) {
+        if (entriesLeft == 0) {
+            // a single log file can not hold more than n entries.
+            if (stream->ctx->segmentPrefix == NULL) {
+                fprintf(stderr, "Error: The log file is full.\n");
+                abortStream(stream);
+                break;
+            }
+
+            entry.rollOver = 1;
+            if (queuePush(stream, &stream->entries, &entry) != 1) {
+                break;
+            }
+
+            pthread_mutex_lock(&stream->lock);
+            while (!stream->keyReady && !stream->aborted) {
+                pthread_cond_wait(&stream->changed, &stream->lock);
+            }
+            memcpy(key, stream->key, KEY_SIZE);
+            entriesLeft = stream->entriesLeft;
+            m = stream->m;
+            stream->keyReady = 0;
+            int aborted = stream->aborted;
+            pthread_mutex_unlock(&stream->lock);
+
+            if (aborted) {
+                break;
+            }
+        }
+
+        entry.rollOver = 0;
+        if (PrepareLogEntry(key, &stream->ctx->layout, m, line.data, line.length, &entry.entry) != 1) {
+            abortStream(stream);
+            break;
+        }
+        memcpy(key, entry.entry.nextKey, KEY_SIZE);
+        entriesLeft--;
+
+        if (queuePush(stream, &stream->entries, &entry) != 1) {
+            break;
+        }
+    }
+
+    memset(key, 0, KEY_SIZE);
+    memset(&line, 0, sizeof(line));
+    memset(&entry, 0, sizeof(entry));
+    queueClose(stream, &stream->entries);
+    return NULL;
+}
+
+// helper function:
+// allocates a queue of capacity items.
+static int createQueue(StreamQueue *queue, size_t itemSize, int capacity)
+{
+    queue->items = calloc(capacity, itemSize);
+    queue->itemSize = itemSize;
+    queue->capacity = capacity;
+    return queue->items != NULL;
+}
+
+// helper function:
+// erases and frees the items, the queues hold key material.
+static void destroyQueue(StreamQueue *queue)
+{
+    if (queue->items == NULL) {
+        return;
+    }
+
+    memset(queue->items, 0, queue->itemSize * queue->capacity);
+    free(queue->items);
+    queue->items = NULL;
+}
+
+// helper function:
+// copies the item into the queue, blocks while the queue is full. returns 0 if the stream has been aborted.
+static int queuePush(LogStream *stream, StreamQueue *queue, const void *item)
+{
+    pthread_mutex_lock(&stream->lock);
+    while (queue->count == queue->capacity && !stream->aborted) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+
+    if (stream->aborted) {
+        pthread_mutex_unlock(&stream->lock);
+        return 0;
+    }
+
+    memcpy(queue->items + ((queue->first + queue->count) % queue->capacity) * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    return 1;
+}
+
+// helper function:
+// copies the oldest item out of the queue, blocks while the queue is empty. returns 0 after the queue has been closed
+// and emptied, or if the stream has been aborted.
+static int queuePop(LogStream *stream, StreamQueue *queue, void *item)
+{
+    pthread_mutex_lock(&stream->lock);
+    while (queue->count == 0 && !queue->closed && !stream->aborted) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+
+    if (stream->aborted || queue->count == 0) {
+        pthread_mutex_unlock(&stream->lock);
+        return 0;
+    }
+
+    unsigned char *slot = queue->items + queue->first * queue->itemSize;
+    memcpy(item, slot, queue->itemSize);
+    memset(slot, 0, queue->itemSize);
+    queue->first = (queue->first + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    return 1;
+}
+
+// helper function:
+// marks the end of the items.
+static void queueClose(LogStream *stream, StreamQueue *queue)
+{
+    pthread_mutex_lock(&stream->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+// helper function:
+// stops all stages, blocked pushes and pops return.
+static void abortStream(LogStream *stream)
+{
+    pthread_mutex_lock(&stream->lock);
+    stream->aborted = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+}
@@ -0,0 +1,37 @@
+//
+//  LogStream.h
+//  logger
+//  Streams log entries from a file, stdin or a FIFO into the log file, with a fixed amount of memory. Three stages
+//  overlap: a reader thread reads the lines, a prepare thread encrypts them (PrepareLogEntry), and the calling thread
+//  writes them into their slots (CommitLogEntry). The stages are connected by bounded queues, a full queue blocks the
+//  previous stage. In the packed mode (a packer in the context) the reader packs the lines into entries itself.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef LogStream_h
+#define LogStream_h
+
+#include "PI.h"
+
+#define DEFAULT_STREAM_QUEUE_DEPTH 64 // entries in flight between two stages.
+
+/*
+ * Function: StreamLogEntries
+ * --------------------------
+ * Reads the input line by line and adds every line as a log entry, until the end of the input or maxEntries lines.
+ * Lines longer than the max log length are split. In the packed mode, consecutive lines are packed into a single entry
+ * (see MessagePacker). The log file (or the current segment) has to be initialized.
+ *
+ * ctx: Logger Context.
+ * input: the input stream, read until EOF.
+ * maxEntries: maximum number of lines to add, packed or not.
+ * queueDepth: number of entries in flight between two stages.
+ * written: will hold the number of added entries, also on failure.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int StreamLogEntries(PIContext *ctx, FILE *input, unsigned long maxEntries, int queueDepth, unsigned long *written);
+
+#endif /* LogStream_h */
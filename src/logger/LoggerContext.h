@@ -9,12 +9,32 @@
 #ifndef LoggerContext_h
 #define LoggerContext_h
 
+#include "Durability.h"
+
 // A struct to hold the context of the logger.
 typedef struct {
     const char *outputPath;
     const char *logPath; // input path
     const char *logFileName;
     int maxLogs;
+    int threads; // number of threads used for the initialization, 0 uses all cores.
+    int backgroundInit; // write the random pad in the background.
+    int segmentSize; // (n) number of entries of a segment, 0 writes a single log file.
+    int spares; // number of pre-padded spare segments, kept ready in the background.
+    DurabilityMode durability; // when the log file and the key are synced.
+    int batchSize; // entries per sync in the batch mode, 0 uses the default.
+    int syncIntervalMs; // time between syncs in the interval mode, 0 uses the default.
+    int journal; // slot writes go through the redo journal.
+    int resume; // continue the existing log file, instead of creating a new one.
+    const char *socketPath; // run as a server on this socket, instead of reading the input path.
+    const char *shmName; // run as the writer of this shared memory ring, instead of reading the input path.
+    unsigned long shmSlots; // number of slots of the shared memory ring, 0 uses the default.
+    int pack; // short messages are packed into a single entry.
+    int packTimeoutMs; // time a packed entry waits for more messages, 0 uses the default.
+    int messageLen; // message len of a new log file, 0 uses MESSAGE_LEN.
+    int k; // slots per entry of a new log file, 0 uses K.
+    double c; // ratio of slots to entries of a new log file, 0 uses C.
+    int splitLayout; // a new log file stores the tags and IDs apart from the payloads.
 } LoggerContext;
 
 #endif /* LoggerContext_h */
@@ -0,0 +1,79 @@
+//
+//  MessagePacker.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "MessagePacker.h"
+#include <string.h>
+
+void InitMessagePacker(MessagePacker *packer, int messageLen, long timeoutMs)
+{
+    memset(packer, 0, sizeof(MessagePacker));
+    packer->messageLen = messageLen;
+    packer->timeoutMs = timeoutMs;
+}
+
+int PackerAppend(MessagePacker *packer, const unsigned char *message, size_t length)
+{
+    if (length > (size_t)PACK_MAX_MESSAGE_LEN(packer->messageLen) || packer->count == PACK_MAX_RECORDS
+        || (packer->count > 0 && packer->used + PACK_RECORD_HEADER_LEN + length > (size_t)packer->messageLen)) {
+        return 0;
+    }
+
+    if (packer->count == 0) {
+        // 0x00 'P' 'K' <count>, a plain entry never starts with a 0 byte (see PlainMessageLength).
+        memset(packer->payload, 0, packer->messageLen);
+        packer->payload[1] = 'P';
+        packer->payload[2] = 'K';
+        packer->used = PACK_HEADER_LEN;
+        clock_gettime(CLOCK_MONOTONIC, &packer->opened);
+    }
+
+    packer->payload[packer->used] = (unsigned char)(length >> 8);
+    packer->payload[packer->used + 1] = (unsigned char)length;
+    memcpy(packer->payload + packer->used + PACK_RECORD_HEADER_LEN, message, length);
+    packer->used += PACK_RECORD_HEADER_LEN + length;
+    packer->payload[3] = (unsigned char)++packer->count;
+
+    return 1;
+}
+
+const unsigned char *PackerTake(MessagePacker *packer, int *length)
+{
+    if (packer->count == 0) {
+        return NULL;
+    }
+
+    *length = (int)packer->used;
+    packer->count = 0;
+    packer->used = 0;
+    return packer->payload;
+}
+
+long PackerRemainingMs(const MessagePacker *packer)
+{
+    struct timespec now;
+
+    if (packer->count == 0) {
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed = (now.tv_sec - packer->opened.tv_sec) * 1000 + (now.tv_nsec - packer->opened.tv_nsec) / 1000000;
+    return elapsed >= packer->timeoutMs ? 0 : packer->timeoutMs - elapsed;
+}
+
+size_t PlainMessageLength(const unsigned char *message, size_t length)
+{
+    return length > 0 && message[0] == 0x00 ? 0 : length;
+}
+
+void ClearMessagePacker(MessagePacker *packer)
+{
+    memset(packer->payload, 0, sizeof(packer->payload));
+    packer->count = 0;
+    packer->used = 0;
+}
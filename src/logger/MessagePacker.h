@@ -0,0 +1,86 @@
+//
+//  MessagePacker.h
+//  logger
+//  Packs consecutive short log messages into a single entry of the message len of the log file: a header (PACK_HEADER_LEN) and one
+//  length prefixed record per message. A packed entry costs a single key evolution, encryption and K slot writes for
+//  all its messages. The verifier splits it with UnpackMessage.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef MessagePacker_h
+#define MessagePacker_h
+
+#include "PIShared.h"
+#include <stddef.h>
+#include <time.h>
+
+#define DEFAULT_PACK_TIMEOUT_MS 100 // a partially filled entry is written after this time.
+#define PACK_MAX_MESSAGE_LEN(l) ((l) - PACK_HEADER_LEN - PACK_RECORD_HEADER_LEN) // longer messages are not packed.
+
+typedef struct {
+    unsigned char payload[MAX_MESSAGE_LEN];
+    int messageLen; // capacity of an entry, the message len of the log file.
+    size_t used; // bytes of the payload, including the header.
+    int count; // number of records.
+    struct timespec opened; // time of the first record.
+    long timeoutMs;
+} MessagePacker;
+
+/*
+ * Function: InitMessagePacker
+ * ---------------------------
+ * Initializes an empty packer.
+ *
+ * messageLen: the message len of the log file.
+ * timeoutMs: time after the first record, after which the entry is due (see PackerRemainingMs).
+ */
+void InitMessagePacker(MessagePacker *packer, int messageLen, long timeoutMs);
+
+/*
+ * Function: PackerAppend
+ * ----------------------
+ * Appends the message as a record.
+ *
+ * returns: 1 if the message has been appended, 0 if it does not fit: the packer has to be taken first (or the message is
+ * longer than PACK_MAX_MESSAGE_LEN(messageLen), and is written as a plain entry).
+ */
+int PackerAppend(MessagePacker *packer, const unsigned char *message, size_t length);
+
+/*
+ * Function: PackerTake
+ * --------------------
+ * Returns the packed entry and empties the packer. The payload stays valid until the next PackerAppend.
+ *
+ * length: will hold the length of the entry.
+ *
+ * returns: the entry, NULL if the packer is empty.
+ */
+const unsigned char *PackerTake(MessagePacker *packer, int *length);
+
+/*
+ * Function: PackerRemainingMs
+ * ---------------------------
+ * returns: the time until the entry is due, 0 if it is due and -1 if the packer is empty.
+ */
+long PackerRemainingMs(const MessagePacker *packer);
+
+/*
+ * Function: PlainMessageLength
+ * ----------------------------
+ * A plain message ends at its first 0 byte (see UnpackMessage), a message which starts with one is written as an empty
+ * entry. Otherwise a client could forge the packed header, and with it any number of records.
+ *
+ * returns: the length of the message as a plain entry.
+ */
+size_t PlainMessageLength(const unsigned char *message, size_t length);
+
+/*
+ * Function: ClearMessagePacker
+ * ----------------------------
+ * Erases the payload.
+ */
+void ClearMessagePacker(MessagePacker *packer);
+
+#endif /* MessagePacker_h */
@@ -7,6 +7,7 @@
 //
 
 #include "PI.h"
+#include "PseudoRandomPad.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
@@ -14,75 +15,136 @@
 
 #include <unistd.h>
 #include <math.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #define SESSION_KEY
 
 // Prototype decleration
 static int createNewLogFile(FILE *file, unsigned long fileSize);
-static void initializeLogFileWithPseudoRandomPad(PRGContext *ctx, FILE *file, size_t m);
-static int writePRGToFile(PRGContext *ctx, FILE *file, unsigned char *buffer, int bufferSize);
+static FILE *openNewLogFile(PIContext *ctx, const char *logFilePrefix, unsigned char masterKey[KEY_SIZE], char **logFilePath);
+static int nextSegment(PIContext *ctx);
+static int appendManifest(PIContext *ctx);
+static int resumeManifest(PIContext *ctx, const char *manifestPath, const char *logFilePrefix);
+static int replayJournal(PIContext *ctx, int *resumable);
+static int readSlot(PIContext *ctx, int l, unsigned char *buffer);
 static int updateKey(PIContext *ctx);
+static int commitEntries(PIContext *ctx, int force);
+static int writeSlot(PIContext *ctx, int l, unsigned char *buffer);
+static int openJournal(PIContext *ctx);
+static int commitJournal(PIContext *ctx);
+static int checkpointJournal(PIContext *ctx);
 static int writeKey(unsigned char key[KEY_SIZE], char *path);
-static int encryptLog(unsigned char *key, unsigned char *logMessage, int logMessageSize, unsigned char *cipherLogMessage);
+static int readLogFileHeader(PIContext *ctx, off_t fileSize);
+static int encryptLog(unsigned char *key, int messageLen, unsigned char *logMessage, int logMessageSize, unsigned char *cipherLogMessage);
+static int addEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize);
 
 int AddLogEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize)
 {
-    unsigned char encKey[KEY_SIZE], drnKey[KEY_SIZE], tagKey[KEY_SIZE], idKey[KEY_SIZE],
-        cipherLogMessage[MESSAGE_LEN + IV_SIZE + MAC_LEN],
-        TauiBuffer[LOG_LEN],
-        XORlj[MESSAGE_LEN + IV_SIZE + MAC_LEN],
-        Tlj[INTEGRITY_TAG_LEN],
-        IDlj[ID_LEN];
+    return addEntry(ctx, logMessage, (int)PlainMessageLength(logMessage, logMessageSize));
+}
+
+// helper function:
+// adds the entry as it is, a plain message or a packed one.
+static int addEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize)
+{
+    PreparedLogEntry entry;
+    struct timespec start, end;
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // roll over to the next segment, once the current one holds n entries.
+    if (RollOverLogFile(ctx) != 1) {
+        return 0;
+    }
+    
+    int success = PrepareLogEntry(ctx->sessionKey, &ctx->layout, ctx->m, logMessage, logMessageSize, &entry) == 1
+                  && CommitLogEntry(ctx, &entry) == 1;
+    memset(&entry, 0, sizeof(entry));
+    
+    if (!success) {
+        return 0;
+    }
     
-    int kRandom[K];
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    RecordLatency(&ctx->latency, (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec);
+    
+    return 1;
+}
+
+int PrepareLogEntry(const unsigned char key[KEY_SIZE], const LogFileLayout *layout, int m, unsigned char *logMessage, int logMessageSize, PreparedLogEntry *entry)
+{
+    const int messageLen = layout->messageLen;
+    unsigned char encKey[KEY_SIZE], drnKey[KEY_SIZE], idKey[KEY_SIZE];
+    int success = 0;
+    
+    // messages longer than the max log length are truncated.
+    if (logMessageSize > messageLen) {
+        logMessageSize = messageLen;
+    }
     
     // derive keys
-    if (0 == DeriveSubKeys(ctx->sessionKey, encKey, drnKey, tagKey, idKey))
+    if (0 == DeriveSubKeys((unsigned char *)key, encKey, drnKey, entry->tagKey, idKey))
     {
         perror("Error: Failed to derive sub.\n");
-        return 0;
+        goto cleanup;
     }
     
-    
-    // cipherLogMessage = malloc(MESSAGE_LEN + IV_SIZE + MAC_LEN);
     // line 1
-    if (0 == encryptLog(encKey, logMessage, logMessageSize, cipherLogMessage)) {
+    if (0 == encryptLog(encKey, messageLen, logMessage, logMessageSize, entry->cipher)) {
         perror("Error: Failed to encrypt the log message.\n");
-        
-        return 0;
+        goto cleanup;
     }
     
     // Create the k distinct random locations within the number m (which is the log file "length").
     // line 2
-    if (0 == DRN(drnKey, K, ctx->m, kRandom)){
+    if (0 == DRN(drnKey, layout->k, m, entry->slots)){
         perror("Error: Failed to create k distinct random numbers.\n");
+        goto cleanup;
+    }
+    
+    // create the IDs, they do not depend on the content of the slots.
+    // line 7
+    for (int j = 0; j < layout->k; ++j) {
+        if (0 == CreateID(idKey, j, entry->ids[j])) {
+            printf("Error: Failed to create ID.\n");
+            goto cleanup;
+        }
+    }
+    
+    // key evolution, the next key is taken over by CommitLogEntry.
+    // line 9
+    KeyEvolution((unsigned char *)key, entry->nextKey);
+    success = 1;
+    
+cleanup:
+    memset(encKey, 0, KEY_SIZE);
+    memset(drnKey, 0, KEY_SIZE);
+    memset(idKey, 0, KEY_SIZE);
+    return success;
+}
+
+int CommitLogEntry(PIContext *ctx, PreparedLogEntry *entry)
+{
+    unsigned char TauiBuffer[MAX_LOG_LEN],
+        XORlj[MAX_CIPHERTEXT_LEN],
+        Tlj[INTEGRITY_TAG_LEN];
+    const size_t cipherLen = CIPHERTEXT_LEN_OF(ctx->layout.messageLen);
+    
+    // a single log file can not hold more than n entries.
+    if (ctx->entries >= ctx->maxEntries) {
+        fprintf(stderr, "Error: The log file is full.\n");
         return 0;
     }
     
     // XOR ci (the encrypted log file) at the k distinct random locations within the log file.
     // line 4
     int l;
-    for (int j = 0; j < K; ++j) {
-        l = kRandom[j];
-        
-        // seek to the requiered location within the log file
-        if (fseek(ctx->logFile, l * LOG_LEN, SEEK_SET) != 0) {
-            printf("Error: Unable to move the file position indicator.\n");
-            
-            return 0;
-        }
-        
-        // Check for read errors or end-of-file
-        if (ferror(ctx->logFile)) {
-            printf("Error: reading from the file.\n");
-            
-            int errnum = errno;
-            fprintf(stderr, "Error opening file: %s\n", strerror(errnum));
-            return 0;
-        }
+    for (int j = 0; j < ctx->layout.k; ++j) {
+        l = entry->slots[j];
         
         // read the location from the log file.
-        if (fread(TauiBuffer, 1, LOG_LEN, ctx->logFile) != LOG_LEN) {
+        if (0 == readSlot(ctx, l, TauiBuffer)) {
             printf("Error: reading from the file.\n");
             int errnum = errno;
             fprintf(stderr, "Error opening file: %s\n", strerror(errnum));
@@ -93,39 +155,24 @@ int AddLogEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize)
         // cipher ⊕ XORlj
         // XOR the XOR parts.
         // line 5
-        for (int i = 0; i < CIPHERTEXT_LEN; ++i) {
-            XORlj[i] = TauiBuffer[i] ^ cipherLogMessage[i];
+        for (size_t i = 0; i < cipherLen; ++i) {
+            XORlj[i] = TauiBuffer[i] ^ entry->cipher[i];
         }
         
         // create integrity TAG
         // line 6
-        if (0 == CreateIntegrityTag(tagKey, XORlj, Tlj)) {
+        if (0 == CreateIntegrityTag(entry->tagKey, XORlj, cipherLen, Tlj)) {
             printf("Error: Failed to create the integrity tag.\n");
             
             return 0;
         }
         
-        // create ID
-        // line 7
-        if (0 == CreateID(idKey, j, IDlj)) {
-            printf("Error: Failed to create ID.\n");
-            
-            return 0;
-        }
-        
-        // seek to the position again
-        if (fseek(ctx->logFile, l * LOG_LEN, SEEK_SET) != 0) {
-            printf("Error: Unable to move the file position indicator.\n");
-            
-            return 0;
-        }
-        
-        memcpy(TauiBuffer, XORlj, CIPHERTEXT_LEN);
-        memcpy(TauiBuffer + CIPHERTEXT_LEN, Tlj, INTEGRITY_TAG_LEN);
-        memcpy(TauiBuffer + CIPHERTEXT_LEN + INTEGRITY_TAG_LEN, IDlj, ID_LEN);
+        memcpy(TauiBuffer, XORlj, cipherLen);
+        memcpy(TauiBuffer + cipherLen, Tlj, INTEGRITY_TAG_LEN);
+        memcpy(TauiBuffer + cipherLen + INTEGRITY_TAG_LEN, entry->ids[j], ID_LEN);
         
         // write back to file
-        if (fwrite(TauiBuffer, 1, LOG_LEN, ctx->logFile) != LOG_LEN) {
+        if (writeSlot(ctx, l, TauiBuffer) != 1) {
             printf("Error: Failed to write the XORed log message back.\n");
             
             return 0;
@@ -134,14 +181,61 @@ int AddLogEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize)
     
     // key evolution
     // line 9
-    updateKey(ctx);
+    ctx->entries++;
+    memcpy(ctx->sessionKey, entry->nextKey, KEY_SIZE);
+    ctx->pendingEntries++;
+    
+    return commitEntries(ctx, 0);
+}
+
+int AddLogMessage(PIContext *ctx, unsigned char *logMessage, int logMessageSize)
+{
+    if (ctx->packer == NULL) {
+        return AddLogEntry(ctx, logMessage, logMessageSize);
+    }
+    
+    if (PackerAppend(ctx->packer, logMessage, logMessageSize) == 1) {
+        return PackerRemainingMs(ctx->packer) == 0 ? FlushLogMessages(ctx) : 1;
+    }
+    
+    // the entry is full, the message starts the next one. A message too long to be packed is written on its own.
+    if (FlushLogMessages(ctx) != 1) {
+        return 0;
+    }
+    
+    return PackerAppend(ctx->packer, logMessage, logMessageSize) == 1 ? 1 : AddLogEntry(ctx, logMessage, logMessageSize);
+}
+
+int FlushLogMessages(PIContext *ctx)
+{
+    const unsigned char *payload;
+    int length;
+    
+    if (ctx->packer == NULL || (payload = PackerTake(ctx->packer, &length)) == NULL) {
+        return 1;
+    }
+    
+    return addEntry(ctx, (unsigned char *)payload, length);
+}
+
+int FlushLogEntries(PIContext *ctx)
+{
+    return commitEntries(ctx, 1);
+}
+
+int RollOverLogFile(PIContext *ctx)
+{
+    if (ctx->segmentPrefix != NULL && ctx->entries >= ctx->maxEntries && nextSegment(ctx) != 1) {
+        perror("Error: Failed to continue with the next segment.\n");
+        return 0;
+    }
     
     return 1;
 }
 
 void Init(PIContext *ctx)
 {
-    size_t fileSize = ctx->m * LOG_LEN; // m * LOG_LEN
+    size_t fileSize = (size_t)LogFileSize(&ctx->layout, ctx->m); // header + m * logLen
     // line 2
     if (createNewLogFile(ctx->logFile, fileSize) == 0){
         /* Failed to create new log file. */
@@ -149,21 +243,40 @@ void Init(PIContext *ctx)
         exit(EXIT_FAILURE);
     }
     
-    // declare context outside of the file preperation, to reuse the given context if more then one file will be filled up. (not in this thesis)
-    PRGContext *prgContext = CreatePRGContext(ctx->sessionKey);
-    if (prgContext == NULL) {
-        perror("ERROR: Failed to create the prg Context.");
+    // the header is authenticated with k0, which is still the session key.
+    if (WriteLogFileHeader(fileno(ctx->logFile), &ctx->layout, ctx->maxEntries, ctx->m, ctx->sessionKey) != 1) {
+        perror("ERROR: Failed to write the log file header.");
         exit(EXIT_FAILURE);
     }
+    
     // line 4
-    // write random pad.
-    initializeLogFileWithPseudoRandomPad(prgContext, ctx->logFile, ctx->m);
+    if (ctx->backgroundInit) {
+        // write random pad in the background, slots which are needed earlier will be materialized by AddLogEntry.
+        char progressPath[strlen(ctx->logFilePath) + strlen(PAD_PROGRESS_EXTENSION) + 1];
+        strcpy(progressPath, ctx->logFilePath);
+        strcat(progressPath, PAD_PROGRESS_EXTENSION);
+        
+        if ((ctx->padFiller = StartPadFiller(ctx->sessionKey, fileno(ctx->logFile), &ctx->layout, ctx->m, progressPath, 0)) == NULL) {
+            perror("ERROR: Failed to start writing the random pad.");
+            exit(EXIT_FAILURE);
+        }
+    } else if (WritePseudoRandomPad(ctx->sessionKey, fileno(ctx->logFile), &ctx->layout, ctx->m, ctx->threads) != 1) {
+        // write random pad, every thread generates and writes whole chunks at their PRG counter offset.
+        perror("ERROR: Failed to write the random pad.");
+        exit(EXIT_FAILURE);
+    }
     
-    free(prgContext);
+    if (openJournal(ctx) != 1) {
+        perror("ERROR: Failed to create the journal.");
+        exit(EXIT_FAILURE);
+    }
     
-    // First key evolution.
+    // First key evolution, k1 is written whatever the durability mode is.
     // line 6
-    updateKey(ctx);
+    if (updateKey(ctx) != 1 || commitEntries(ctx, 1) != 1) {
+        perror("ERROR: Failed to write the first key.");
+        exit(EXIT_FAILURE);
+    }
 }
 
 PIContext *CreatePIContext(unsigned long n, const char *keyPath, const char *logFileDir, const char* logFilePrefix)
@@ -211,16 +324,22 @@ PIContext *CreatePIContext(unsigned long n, const char *keyPath, const char *log
     }
     
     ctx->keyPath = sessionKeyPath;
+    ctx->keyDirectory = keyPath;
     ctx->logFileDirectory = logFileDir;
     ctx->maxEntries = n;
-    ctx->m = ceil(n * C);
+    InitLogFileLayout(&ctx->layout, MESSAGE_LEN, K, C);
+    ctx->m = (int)SlotCount(&ctx->layout, n);
     ctx->logFileNamePrefix = logFilePrefix;
+    ctx->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ctx->batchSize = DEFAULT_BATCH_SIZE;
+    ctx->syncIntervalMs = DEFAULT_SYNC_INTERVAL_MS;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->lastSync);
     
     
     // Create Key File
-    ctx->keyFile = fopen(ctx->keyPath, "wb");
+    ctx->keyStore = CreateKeyStore(ctx->keyPath);
     
-    if (ctx->keyFile == NULL) {
+    if (ctx->keyStore == NULL) {
         perror("ERROR: Failed to open the key file.");
         exit(EXIT_FAILURE);
     }
@@ -241,11 +360,287 @@ PIContext *CreatePIContext(unsigned long n, const char *keyPath, const char *log
         free(logFilePath);
         exit(EXIT_FAILURE);
     }
-    free(logFilePath);
+    ctx->logFilePath = logFilePath;
+    
+    return ctx;
+}
+
+PIContext *CreateSegmentedPIContext(unsigned long n, const char *keyPath, const char *logFileDir, const char *logFilePrefix)
+{
+    PIContext *ctx = calloc(1, sizeof(PIContext));
+    unsigned char masterKey[KEY_SIZE];
+    char sessionKeyfileName[] = "currentSessionKey.key";
+    char *sessionKeyPath = calloc(strlen(keyPath) + strlen(sessionKeyfileName) + 1, sizeof(char));
+    char manifestPath[strlen(logFileDir) + strlen(logFilePrefix) + strlen(MANIFEST_EXTENSION) + 1];
+    
+    strcpy(sessionKeyPath, keyPath);
+    strcat(sessionKeyPath, sessionKeyfileName);
+    strcpy(manifestPath, logFileDir);
+    strcat(manifestPath, logFilePrefix);
+    strcat(manifestPath, MANIFEST_EXTENSION);
+    
+    ctx->keyPath = sessionKeyPath;
+    ctx->keyDirectory = keyPath;
+    ctx->logFileDirectory = logFileDir;
+    ctx->maxEntries = n;
+    InitLogFileLayout(&ctx->layout, MESSAGE_LEN, K, C);
+    ctx->m = (int)SlotCount(&ctx->layout, n);
+    ctx->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ctx->batchSize = DEFAULT_BATCH_SIZE;
+    ctx->syncIntervalMs = DEFAULT_SYNC_INTERVAL_MS;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->lastSync);
+    ctx->segmentPrefix = logFilePrefix;
+    ctx->segmentName = calloc(strlen(logFilePrefix) + 3, sizeof(char));
+    strcpy(ctx->segmentName, logFilePrefix);
+    strcat(ctx->segmentName, ".0");
+    ctx->logFileNamePrefix = ctx->segmentName;
+    
+    if ((ctx->keyStore = CreateKeyStore(ctx->keyPath)) == NULL) {
+        perror("ERROR: Failed to open the key file.");
+        exit(EXIT_FAILURE);
+    }
+    
+    if ((ctx->manifest = fopen(manifestPath, "w")) == NULL) {
+        perror("ERROR: Failed to open the manifest.");
+        exit(EXIT_FAILURE);
+    }
+    
+    // the first segment, is initialized by Init.
+    if ((ctx->logFile = openNewLogFile(ctx, ctx->segmentName, masterKey, &ctx->logFilePath)) == NULL
+        || appendManifest(ctx) != 1) {
+        perror("ERROR: Failed to create the first segment.");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Set key0
+    memcpy(ctx->sessionKey, masterKey, KEY_SIZE);
+    memset(masterKey, 0, KEY_SIZE);
     
     return ctx;
 }
 
+int SwapLogFile(PIContext *ctx, const char *logFilePrefix)
+{
+    unsigned char masterKey[KEY_SIZE];
+    char *logFilePath;
+    FILE *logFile;
+    
+    // the entries are durable first, the pad progress is removed with the filler.
+    if (commitEntries(ctx, 1) != 1 || SyncFile(fileno(ctx->logFile)) != 1 || checkpointJournal(ctx) != 1) {
+        perror("ERROR: Failed to sync the log file.");
+        return 0;
+    }
+    
+    // the old log file is complete, only after the whole pad has been written.
+    if (ctx->padFiller != NULL) {
+        int finished = FinishPadFiller(ctx->padFiller);
+        ctx->padFiller = NULL;
+        
+        if (finished != 1) {
+            perror("ERROR: Failed to finish the random pad.");
+            return 0;
+        }
+    }
+    CloseJournal(ctx->journal, 1);
+    ctx->journal = NULL;
+    
+    if ((logFile = openNewLogFile(ctx, logFilePrefix, masterKey, &logFilePath)) == NULL) {
+        return 0;
+    }
+    
+    fclose(ctx->logFile);
+    free(ctx->logFilePath);
+    ctx->logFile = logFile;
+    ctx->logFilePath = logFilePath;
+    ctx->logFileNamePrefix = logFilePrefix;
+    ctx->entries = 0;
+    
+    // the sequence numbers of the key store start over with the new log file.
+    CloseKeyStore(ctx->keyStore);
+    if ((ctx->keyStore = CreateKeyStore(ctx->keyPath)) == NULL) {
+        return 0;
+    }
+    
+    // Set key0
+    memcpy(ctx->sessionKey, masterKey, KEY_SIZE);
+    memset(masterKey, 0, KEY_SIZE);
+    
+    if (ctx->logPool == NULL) {
+        Init(ctx);
+    } else {
+        // First key evolution, the spare has been padded already.
+        if (openJournal(ctx) != 1 || updateKey(ctx) != 1 || commitEntries(ctx, 1) != 1) {
+            perror("ERROR: Failed to write the first key.");
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+PIContext *ResumePIContext(const char *keyPath, const char *logFileDir, const char *logFilePrefix)
+{
+    PIContext *ctx = calloc(1, sizeof(PIContext));
+    char sessionKeyfileName[] = "currentSessionKey.key";
+    char *sessionKeyPath = calloc(strlen(keyPath) + strlen(sessionKeyfileName) + 1, sizeof(char));
+    char manifestPath[strlen(logFileDir) + strlen(logFilePrefix) + strlen(MANIFEST_EXTENSION) + 1];
+    unsigned long sequence;
+    int resumable = 0;
+    struct stat st;
+    
+    strcpy(sessionKeyPath, keyPath);
+    strcat(sessionKeyPath, sessionKeyfileName);
+    strcpy(manifestPath, logFileDir);
+    strcat(manifestPath, logFilePrefix);
+    strcat(manifestPath, MANIFEST_EXTENSION);
+    
+    ctx->keyPath = sessionKeyPath;
+    ctx->keyDirectory = keyPath;
+    ctx->logFileDirectory = logFileDir;
+    ctx->logFileNamePrefix = logFilePrefix;
+    ctx->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ctx->batchSize = DEFAULT_BATCH_SIZE;
+    ctx->syncIntervalMs = DEFAULT_SYNC_INTERVAL_MS;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->lastSync);
+    
+    // a segmented log continues with its last segment.
+    if (access(manifestPath, F_OK) == 0 && resumeManifest(ctx, manifestPath, logFilePrefix) != 1) {
+        fprintf(stderr, "ERROR: Failed to read the manifest.\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char *logFilePath = calloc(strlen(logFileDir) + strlen(ctx->logFileNamePrefix) + strlen(LOG_EXTENSION) + 1, sizeof(char));
+    strcpy(logFilePath, logFileDir);
+    strcat(logFilePath, ctx->logFileNamePrefix);
+    strcat(logFilePath, LOG_EXTENSION);
+    ctx->logFilePath = logFilePath;
+    
+    // the log file is kept as it is.
+    if ((ctx->logFile = fopen(logFilePath, "rb+")) == NULL || fstat(fileno(ctx->logFile), &st) != 0
+        || readLogFileHeader(ctx, st.st_size) != 1) {
+        fprintf(stderr, "ERROR: No log file to resume: %s\n", logFilePath);
+        exit(EXIT_FAILURE);
+    }
+    
+    // the key store knows the number of entries, its key belongs to. Without a resumable key, the key of the journal is
+    // used.
+    if ((ctx->keyStore = OpenKeyStore(ctx->keyPath, ctx->sessionKey, &sequence, &resumable)) == NULL || sequence == KEY_STORE_NO_SEQUENCE) {
+        CloseKeyStore(ctx->keyStore);
+        ctx->keyStore = NULL;
+    } else {
+        ctx->entries = sequence;
+    }
+    
+    if (replayJournal(ctx, &resumable) != 1) {
+        fprintf(stderr, "ERROR: Failed to replay the journal.\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (ctx->keyStore == NULL) {
+        fprintf(stderr, "ERROR: The session key store does not hold a resumable key.\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // without the journal, the entries of a crashed logger could have reached the log file ahead of the key. Their
+    // slots would be written a second time with the same key.
+    if (!resumable) {
+        fprintf(stderr, "ERROR: The log has not been closed, and has been written without the journal. Entries could be behind the session key, it can not be resumed.\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("INFO: Resuming %s with %lu of %lu entries.\n", logFilePath, ctx->entries, ctx->maxEntries);
+    return ctx;
+}
+
+void Resume(PIContext *ctx)
+{
+    char progressPath[strlen(ctx->logFilePath) + strlen(PAD_PROGRESS_EXTENSION) + 1];
+    strcpy(progressPath, ctx->logFilePath);
+    strcat(progressPath, PAD_PROGRESS_EXTENSION);
+    
+    // the pad has not been completed before the crash, the fill continues at its last synced progress.
+    if (access(progressPath, F_OK) == 0) {
+        const char *masterKeyName = ctx->segmentName != NULL ? ctx->segmentName : "masterKey";
+        char masterKeyPath[strlen(ctx->keyDirectory) + strlen(masterKeyName) + strlen(MASTER_KEY_EXTENSION) + 1];
+        unsigned char masterKey[KEY_SIZE];
+        
+        strcpy(masterKeyPath, ctx->keyDirectory);
+        if (ctx->segmentName != NULL) {
+            strcat(masterKeyPath, masterKeyName);
+            strcat(masterKeyPath, MASTER_KEY_EXTENSION);
+        } else {
+            strcat(masterKeyPath, "masterKey.key");
+        }
+        
+        if (Readkey(masterKeyPath, masterKey) != 1
+            || (ctx->padFiller = StartPadFiller(masterKey, fileno(ctx->logFile), &ctx->layout, ctx->m, progressPath, 1)) == NULL) {
+            perror("ERROR: Failed to continue writing the random pad.");
+            exit(EXIT_FAILURE);
+        }
+        memset(masterKey, 0, KEY_SIZE);
+    }
+    
+    if (openJournal(ctx) != 1) {
+        perror("ERROR: Failed to create the journal.");
+        exit(EXIT_FAILURE);
+    }
+    
+    // without the journal, the key is not resumable until the log is closed again.
+    if (ctx->journal == NULL && KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 1, 0) != 1) {
+        perror("ERROR: Failed to write the key to the file.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int ClosePIContext(PIContext *ctx)
+{
+    int success = 1;
+    
+    // the last packed entry is written, before the last entries are synced.
+    if (FlushLogMessages(ctx) != 1) {
+        perror("ERROR: Failed to write the last packed entry.");
+        success = 0;
+    }
+    if (ctx->packer != NULL) {
+        ClearMessagePacker(ctx->packer);
+        free(ctx->packer);
+    }
+    
+    // the entries are durable first, the pad progress is removed with the filler.
+    if (commitEntries(ctx, 1) != 1 || checkpointJournal(ctx) != 1) {
+        perror("ERROR: Failed to sync the last entries.");
+        success = 0;
+    }
+    
+    // the log file is complete, only after the whole pad has been written.
+    if (ctx->padFiller != NULL && FinishPadFiller(ctx->padFiller) != 1) {
+        perror("ERROR: Failed to finish the random pad.");
+        success = 0;
+    }
+    ctx->padFiller = NULL;
+    // all entries are on disk, the log can be resumed with the last key.
+    if (success && (SyncFile(fileno(ctx->logFile)) != 1 || KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 1, 1) != 1)) {
+        perror("ERROR: Failed to write the last key.");
+        success = 0;
+    }
+    // a journal, which has not been checkpointed, is kept for the replay.
+    CloseJournal(ctx->journal, success);
+    free(ctx->stagedSlots);
+    
+    DestroyLogPool(ctx->logPool);
+    if (ctx->manifest != NULL) {
+        fclose(ctx->manifest);
+    }
+    fclose(ctx->logFile);
+    CloseKeyStore(ctx->keyStore);
+    free(ctx->logFilePath);
+    free(ctx->keyPath);
+    free(ctx->segmentName);
+    free(ctx);
+    
+    return success;
+}
+
 // helper method:
 // create a new log file of the requested size.
 static int createNewLogFile(FILE *file, unsigned long fileSize)
@@ -254,103 +649,425 @@ static int createNewLogFile(FILE *file, unsigned long fileSize)
         perror("ERROR: File is not opened.");
         return 0;
     }
-        
-    // Seek to file size
-    if (fseek(file, fileSize - 1, SEEK_SET) != 0) {
-        perror("Error seeking to the end of the file");
-        fclose(file);
+    
+    // Reserve the whole file at once, the pad will be written with positional I/O on the descriptor.
+    fflush(file);
+    return PreallocateLogFile(fileno(file), fileSize);
+}
+
+// helper function:
+// opens the log file <logFileDirectory><logFilePrefix>.log.enc with a fresh master key, which is stored as
+// <keyDirectory><logFilePrefix>.masterKey.key. A spare of the log pool has been padded already, a new file still needs Init.
+static FILE *openNewLogFile(PIContext *ctx, const char *logFilePrefix, unsigned char masterKey[KEY_SIZE], char **logFilePath)
+{
+    char masterKeyPath[strlen(ctx->keyDirectory) + strlen(logFilePrefix) + strlen(MASTER_KEY_EXTENSION) + 1];
+    char *path = calloc(strlen(ctx->logFileDirectory) + strlen(logFilePrefix) + strlen(LOG_EXTENSION) + 1, sizeof(char));
+    FILE *logFile;
+    
+    strcpy(masterKeyPath, ctx->keyDirectory);
+    strcat(masterKeyPath, logFilePrefix);
+    strcat(masterKeyPath, MASTER_KEY_EXTENSION);
+    strcpy(path, ctx->logFileDirectory);
+    strcat(path, logFilePrefix);
+    strcat(path, LOG_EXTENSION);
+    
+    if (ctx->logPool != NULL) {
+        // the spare is padded already, only its name changes.
+        if (LogPoolTake(ctx->logPool, path, masterKeyPath, masterKey) != 1
+            || (logFile = fopen(path, "rb+")) == NULL) {
+            perror("ERROR: Failed to take a spare log file.");
+            free(path);
+            return NULL;
+        }
+    } else if (GenerateMasterKey(masterKey) != 1
+               || writeKey(masterKey, masterKeyPath) != 1
+               || (logFile = fopen(path, "wb+")) == NULL) {
+        perror("ERROR: Failed to create the log file.");
+        free(path);
+        return NULL;
+    }
+    
+    *logFilePath = path;
+    return logFile;
+}
+
+// helper function:
+// continues with the next segment, and appends it to the manifest.
+static int nextSegment(PIContext *ctx)
+{
+    char *segmentName = calloc(strlen(ctx->segmentPrefix) + 22, sizeof(char));
+    
+    sprintf(segmentName, "%s.%lu", ctx->segmentPrefix, ctx->segment + 1);
+    
+    if (SwapLogFile(ctx, segmentName) != 1) {
+        free(segmentName);
         return 0;
     }
     
-    // Write a single byte to the end of the file to allocate space
-    fputc('\0', file);
+    free(ctx->segmentName);
+    ctx->segmentName = segmentName;
+    ctx->segment++;
     
+    // the segment is listed, after its log file and master key are in place. It does not hold any entry yet.
+    return appendManifest(ctx);
+}
+
+// helper function:
+// appends the current segment to the manifest.
+static int appendManifest(PIContext *ctx)
+{
+    if (fprintf(ctx->manifest, "%s%s %s%s %lu\n", ctx->segmentName, LOG_EXTENSION, ctx->segmentName, MASTER_KEY_EXTENSION, ctx->maxEntries) < 0
+        || fflush(ctx->manifest) != 0
+        || SyncFile(fileno(ctx->manifest)) != 1) {
+        perror("ERROR: Failed to write the manifest.");
+        return 0;
+    }
     
     return 1;
 }
 
 // helper function:
-// writes the random pad into the empty file.
-static void initializeLogFileWithPseudoRandomPad(PRGContext *ctx, FILE *file, size_t m)
+// reads the last segment of the manifest, and reopens the manifest for the next segments.
+static int resumeManifest(PIContext *ctx, const char *manifestPath, const char *logFilePrefix)
 {
-    unsigned char buffer[LOG_LEN];
+    FILE *manifest = fopen(manifestPath, "r");
+    char logFileName[PATH_MAX], masterKeyName[PATH_MAX], *line = NULL;
+    size_t lineSize = 0;
+    unsigned long n = 0;
+    int found = 0;
     
-    fseek(file, 0, SEEK_SET);
-    // write random pad "line" by "line".
-    for (int i = 0; i < m; ++i) {
-        if (writePRGToFile(ctx, file, buffer, LOG_LEN) != 1) {
-            perror("ERROR: Failed to write the random pad.");
-            exit(EXIT_FAILURE);
+    if (manifest == NULL) {
+        return 0;
+    }
+    
+    while (getline(&line, &lineSize, manifest) != -1) {
+        if (sscanf(line, "%4095s %4095s %lu", logFileName, masterKeyName, &n) == 3) {
+            found = 1;
         }
     }
+    free(line);
+    fclose(manifest);
+    
+    if (!found || strlen(logFileName) <= strlen(LOG_EXTENSION)
+        || strcmp(logFileName + strlen(logFileName) - strlen(LOG_EXTENSION), LOG_EXTENSION) != 0) {
+        return 0;
+    }
+    size_t nameLen = strlen(logFileName) - strlen(LOG_EXTENSION);
+    
+    // <logFilePrefix>.<segment>.log.enc
+    ctx->segmentName = strndup(logFileName, nameLen);
+    ctx->segmentPrefix = logFilePrefix;
+    ctx->segment = strtoul(ctx->segmentName + strlen(logFilePrefix) + 1, NULL, 10);
+    ctx->logFileNamePrefix = ctx->segmentName;
+    ctx->maxEntries = n;
+    
+    return (ctx->manifest = fopen(manifestPath, "a")) != NULL;
 }
 
-// helper function
-// writes a specific amount of pseudo random data into the provided file.
-static int writePRGToFile(PRGContext *ctx, FILE *file, unsigned char *buffer, int bufferSize)
+// helper function:
+// reads the layout, n and m from the header of the log file. Without a header, the log file has the legacy layout.
+static int readLogFileHeader(PIContext *ctx, off_t fileSize)
 {
-    // Create pseudo random data.
-    if (PRG(ctx, buffer, bufferSize) == -1)
-    {
-        perror("ERROR: Creating random PAD.\n");
-        return -1;
+    unsigned char header[LOG_HEADER_LEN];
+    unsigned long n, m;
+    int decoded = 0;
+    
+    if (fileSize >= LOG_HEADER_LEN) {
+        if (PreadAll(fileno(ctx->logFile), header, LOG_HEADER_LEN, 0) != 1) {
+            return 0;
+        }
+        // the master key is not needed to continue the log, the verifier checks the header.
+        decoded = DecodeLogFileHeader(header, NULL, &ctx->layout, &n, &m);
     }
     
-    // write the random data into the file.
-    size_t bytesWritten = fwrite(buffer, 1, bufferSize, file);
+    if (decoded == -1) {
+        return 0;
+    }
     
-    if (bytesWritten != bufferSize)
-    {
-        perror("ERROR: While writing pseudo random PAD to the file.\n");
-        fclose(file);
-        return -1;
+    if (decoded == 1) {
+        if (fileSize != (off_t)LogFileSize(&ctx->layout, m) || (ctx->segmentPrefix != NULL && n != ctx->maxEntries)) {
+            fprintf(stderr, "ERROR: The log file does not match its header.\n");
+            return 0;
+        }
+        ctx->m = (int)m;
+        ctx->maxEntries = n;
+        return 1;
+    }
+    
+    InitLegacyLogFileLayout(&ctx->layout);
+    if (fileSize == 0 || fileSize % LOG_LEN != 0) {
+        return 0;
+    }
+    ctx->m = (int)(fileSize / LOG_LEN);
+    
+    // the largest n, with m = ceil(n * C). A segment has its n in the manifest.
+    if (ctx->segmentPrefix == NULL) {
+        unsigned long n = (unsigned long)(ctx->m / ctx->layout.c);
+        while (SlotCount(&ctx->layout, n + 1) <= (unsigned long)ctx->m) {
+            n++;
+        }
+        ctx->maxEntries = n;
     }
     return 1;
 }
 
 // helper function:
-// key evolution + updating the key file.
+// redoes the records of the journal, which are newer than the key store, and empties the journal afterwards. Without a
+// key store (none holds a resumable key), the key of the newest record replaces it. resumable: set to 1 after a replay,
+// the log has been written with the journal.
+static int replayJournal(PIContext *ctx, int *resumable)
+{
+    char journalPath[strlen(ctx->logFilePath) + strlen(JOURNAL_EXTENSION) + 1];
+    unsigned char key[KEY_SIZE];
+    unsigned long entries;
+    Journal *journal;
+    
+    strcpy(journalPath, ctx->logFilePath);
+    strcat(journalPath, JOURNAL_EXTENSION);
+    
+    if (access(journalPath, F_OK) != 0) {
+        return 1;
+    }
+    
+    if ((journal = OpenJournal(journalPath, &ctx->layout)) == NULL) {
+        return 0;
+    }
+    
+    int replayed = JournalReplay(journal, fileno(ctx->logFile), key, &entries);
+    
+    // the key store is written after the journal, a newer record has not reached the key store before the crash.
+    if (replayed == 1 && (ctx->keyStore == NULL || entries >= ctx->entries)) {
+        memcpy(ctx->sessionKey, key, KEY_SIZE);
+        ctx->entries = entries;
+    }
+    memset(key, 0, KEY_SIZE);
+    
+    // an empty journal holds no key, the journal is kept as it is.
+    if (ctx->keyStore == NULL && replayed != 1) {
+        CloseJournal(journal, 0);
+        return replayed != -1;
+    }
+    
+    if (replayed == -1
+        || (ctx->keyStore == NULL && (ctx->keyStore = CreateKeyStore(ctx->keyPath)) == NULL)
+        || SyncFile(fileno(ctx->logFile)) != 1
+        || KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 1, 1) != 1
+        || JournalCheckpoint(journal) != 1) {
+        CloseJournal(journal, 0);
+        return 0;
+    }
+    
+    CloseJournal(journal, 1);
+    *resumable = 1;
+    return 1;
+}
+
+// helper function:
+// reads the slot l of the log file, while the pad is written in the background the slot could be materialized.
+static int readSlot(PIContext *ctx, int l, unsigned char *buffer)
+{
+    // a staged slot is newer than the log file.
+    for (int i = ctx->stagedCount - 1; i >= 0; --i) {
+        if (ctx->stagedSlots[i].slot == (unsigned long)l) {
+            memcpy(buffer, ctx->stagedSlots[i].data, ctx->layout.logLen);
+            return 1;
+        }
+    }
+    
+    if (ctx->padFiller != NULL) {
+        return PadFillerLoadSlot(ctx->padFiller, l, buffer);
+    }
+    
+    return PreadSlots(fileno(ctx->logFile), &ctx->layout, l, 1, buffer);
+}
+
+// helper function:
+// key evolution + updating the key file, according to the durability mode.
 static int updateKey(PIContext *ctx)
 {
     unsigned char nextKey[KEY_SIZE];
     KeyEvolution(ctx->sessionKey, nextKey);
     
-    fseek(ctx->keyFile, 0, SEEK_SET);
+    memcpy(ctx->sessionKey, nextKey, KEY_SIZE);
+    memset(nextKey, 0, KEY_SIZE);
+    ctx->pendingEntries++;
     
-    size_t writtenT = fwrite(nextKey, 1, KEY_SIZE, ctx->keyFile);
+    return commitEntries(ctx, 0);
+}
+
+// helper function:
+// writes the current key, once it is due in the durability mode. The log file is synced first, so that the key on disk
+// never belongs to an entry which is not on disk. force: write the key of all pending entries now.
+static int commitEntries(PIContext *ctx, int force)
+{
+    struct timespec now;
+    int due = force;
     
-    if (writtenT != KEY_SIZE) {
+    if (ctx->pendingEntries == 0) {
+        return 1;
+    }
+    
+    switch (ctx->durability) {
+        case DURABILITY_NONE:
+            // nothing is synced, the key is written after every entry.
+            if (KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 0, 0) != 1) {
+                perror("ERROR: Failed to write the key to the file.");
+                return 0;
+            }
+            ctx->pendingEntries = 0;
+            return 1;
+        case DURABILITY_ENTRY:
+            due = 1;
+            break;
+        case DURABILITY_BATCH:
+            due = due || ctx->pendingEntries >= ctx->batchSize;
+            break;
+        case DURABILITY_INTERVAL:
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            due = due || (now.tv_sec - ctx->lastSync.tv_sec) * 1000 + (now.tv_nsec - ctx->lastSync.tv_nsec) / 1000000 >= ctx->syncIntervalMs;
+            break;
+    }
+    
+    if (!due) {
+        return 1;
+    }
+    
+    if (ctx->journal != NULL) {
+        return commitJournal(ctx);
+    }
+    
+    // the log writes are ordered before the key write.
+    if (SyncFile(fileno(ctx->logFile)) != 1) {
+        perror("ERROR: Failed to sync the log file.");
+        return 0;
+    }
+    
+    // the next entries reach the log file ahead of their key.
+    if (KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 1, 0) != 1) {
         perror("ERROR: Failed to write the key to the file.");
-        
-        exit(EXIT_FAILURE);
+        return 0;
+    }
+    
+    if (ctx->padFiller != NULL) {
+        PadFillerCommit(ctx->padFiller);
     }
+    ctx->pendingEntries = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->lastSync);
+    return 1;
+}
 
+// helper function:
+// writes the slot l of the log file, with the journal it is staged until the next commit.
+static int writeSlot(PIContext *ctx, int l, unsigned char *buffer)
+{
+    if (ctx->journal == NULL) {
+        return PwriteSlots(fileno(ctx->logFile), &ctx->layout, l, 1, buffer);
+    }
     
-    memcpy(ctx->sessionKey, nextKey, KEY_SIZE);
+    for (int i = ctx->stagedCount - 1; i >= 0; --i) {
+        if (ctx->stagedSlots[i].slot == (unsigned long)l) {
+            memcpy(ctx->stagedSlots[i].data, buffer, ctx->layout.logLen);
+            return 1;
+        }
+    }
+    
+    if (ctx->stagedCount == ctx->stagedCapacity) {
+        int capacity = ctx->stagedCapacity == 0 ? ctx->layout.k * DEFAULT_BATCH_SIZE : ctx->stagedCapacity * 2;
+        JournalSlot *slots = realloc(ctx->stagedSlots, capacity * sizeof(JournalSlot));
+        
+        if (slots == NULL) {
+            return 0;
+        }
+        ctx->stagedSlots = slots;
+        ctx->stagedCapacity = capacity;
+    }
+    
+    ctx->stagedSlots[ctx->stagedCount].slot = l;
+    memcpy(ctx->stagedSlots[ctx->stagedCount].data, buffer, ctx->layout.logLen);
+    ctx->stagedCount++;
     return 1;
 }
 
-int Readkey(char *path, unsigned char key[KEY_SIZE])
+// helper function:
+// creates an empty journal for the current log file, if the journal is used.
+static int openJournal(PIContext *ctx)
 {
-    FILE *file = fopen(path, "rb");
+    if (!ctx->useJournal || ctx->durability == DURABILITY_NONE) {
+        return 1;
+    }
     
-    if(!file)
-    {
-        perror("Failed to open the key file.");
+    char journalPath[strlen(ctx->logFilePath) + strlen(JOURNAL_EXTENSION) + 1];
+    strcpy(journalPath, ctx->logFilePath);
+    strcat(journalPath, JOURNAL_EXTENSION);
+    
+    // the log file is new, a journal of an earlier log file with the same name is dropped.
+    if ((ctx->journal = OpenJournal(journalPath, &ctx->layout)) == NULL || JournalCheckpoint(ctx->journal) != 1) {
         return 0;
     }
     
-    if(fread(key, 1, KEY_SIZE, file) != KEY_SIZE)
-    {
-        perror("Failed to read the key.");
-        fclose(file);
+    return 1;
+}
+
+// helper function:
+// appends the staged slots and the key to the journal, and writes them afterwards. Only the journal is synced.
+static int commitJournal(PIContext *ctx)
+{
+    // the record is durable, before any slot of the commit reaches the log file.
+    if (JournalAppend(ctx->journal, ctx->stagedSlots, ctx->stagedCount, ctx->sessionKey, ctx->entries) != 1) {
         return 0;
     }
+    // the replay restores the claimed slots of the record.
+    if (ctx->padFiller != NULL) {
+        PadFillerCommit(ctx->padFiller);
+    }
     
-    fclose(file);
+    for (int i = 0; i < ctx->stagedCount; ++i) {
+        if (PwriteSlots(fileno(ctx->logFile), &ctx->layout, ctx->stagedSlots[i].slot, 1, ctx->stagedSlots[i].data) != 1) {
+            perror("ERROR: Failed to write the journaled slots.");
+            return 0;
+        }
+    }
+    
+    if (KeyStoreWrite(ctx->keyStore, ctx->sessionKey, ctx->entries, 0, 1) != 1) {
+        perror("ERROR: Failed to write the key to the file.");
+        return 0;
+    }
+    
+    memset(ctx->stagedSlots, 0, ctx->stagedCount * sizeof(JournalSlot));
+    ctx->stagedCount = 0;
+    ctx->pendingEntries = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->lastSync);
+    
+    if (JournalSize(ctx->journal) >= JOURNAL_CHECKPOINT_SIZE) {
+        return checkpointJournal(ctx);
+    }
     return 1;
 }
 
+// helper function:
+// syncs the log file and the key, afterwards the journal is not needed anymore.
+static int checkpointJournal(PIContext *ctx)
+{
+    if (ctx->journal == NULL || JournalSize(ctx->journal) == 0) {
+        return 1;
+    }
+    
+    if (SyncFile(fileno(ctx->logFile)) != 1 || KeyStoreSync(ctx->keyStore) != 1) {
+        perror("ERROR: Failed to sync the journaled files.");
+        return 0;
+    }
+    
+    return JournalCheckpoint(ctx->journal);
+}
+
+int Readkey(char *path, unsigned char key[KEY_SIZE])
+{
+    unsigned long sequence;
+    
+    // the session key store, or a plain key file.
+    return ReadKeyStore(path, key, &sequence);
+}
+
 static int writeKey(unsigned char key[KEY_SIZE], char *path)
 {
     FILE *file = fopen(path, "wb");
@@ -378,17 +1095,18 @@ static int writeKey(unsigned char key[KEY_SIZE], char *path)
  * Will AE$ encrypt the provided log message, by uisng AES_256_CTR + CMAC.
  *
  * key: the current session key for encryption.
+ * messageLen: the message len of the log file, the message is padded to it.
  * logMessage: the log message to encrypt.
  * logMessageSize: the size of the log message.
- * cipherLogMessage: (ci) the ciphertext, always of the size IV + MESSAGE_LEN + MAC_LEN.
+ * cipherLogMessage: (ci) the ciphertext, always of the size IV + messageLen + MAC_LEN.
  *
- * return: 0 on failure and IV_SIZE + MESSAGE_LEN + MAC_LEN on success.
+ * return: 0 on failure and IV_SIZE + messageLen + MAC_LEN on success.
  */
-static int encryptLog(unsigned char *key, unsigned char *logMessage, int logMessageSize, unsigned char *cipherLogMessage)
+static int encryptLog(unsigned char *key, int messageLen, unsigned char *logMessage, int logMessageSize, unsigned char *cipherLogMessage)
 {
     unsigned char iv[IV_SIZE];
-    unsigned char paddedMessage[MESSAGE_LEN];
-    unsigned char ciphertext[MESSAGE_LEN];
+    unsigned char paddedMessage[MAX_MESSAGE_LEN];
+    unsigned char ciphertext[MAX_MESSAGE_LEN];
     unsigned char mac[MAC_LEN];
     int len;
     size_t macLen;
@@ -396,24 +1114,24 @@ static int encryptLog(unsigned char *key, unsigned char *logMessage, int logMess
     GenerateIV(iv);
     
     // padding with 0 bytes.
-    memset(paddedMessage, 0, sizeof(paddedMessage));
+    memset(paddedMessage, 0, messageLen);
     memcpy(paddedMessage, logMessage, logMessageSize);
     
     // encrypt the log message.
-    if (MESSAGE_LEN != (len = AES_256_CTR_encrypt(paddedMessage, MESSAGE_LEN, key, iv, ciphertext)))
+    if (messageLen != (len = AES_256_CTR_encrypt(paddedMessage, messageLen, key, iv, ciphertext)))
     {
         perror("ERROR: Log encryption failed.\n");
         return 0;
     }
     
     memcpy(cipherLogMessage, iv, IV_SIZE);
-    memcpy(cipherLogMessage + IV_SIZE, ciphertext, MESSAGE_LEN);
+    memcpy(cipherLogMessage + IV_SIZE, ciphertext, messageLen);
     
     // Create the MAC.
-    CMAC(key, ciphertext, MESSAGE_LEN, mac, &macLen, MAC_LEN);
+    CMAC(key, ciphertext, messageLen, mac, &macLen, MAC_LEN);
     
-    memcpy(cipherLogMessage + IV_SIZE + MESSAGE_LEN, mac, MAC_LEN);
+    memcpy(cipherLogMessage + IV_SIZE + messageLen, mac, MAC_LEN);
     
     // Return cipherLogMessage len.
-    return IV_SIZE + MESSAGE_LEN + MAC_LEN;
+    return IV_SIZE + messageLen + MAC_LEN;
 }
@@ -12,23 +12,56 @@
 #include "PIShared.h"
 #include <stdio.h>
 #include "Crypto.h"
+#include "PseudoRandomPad.h"
+#include "LogPool.h"
+#include "Durability.h"
+#include "Journal.h"
+#include "KeyStore.h"
+#include "MessagePacker.h"
+#include <time.h>
 
-#define MESSAGE_LEN 1024 // The max len of an log entry message. (l) has to be a multiple of the AES block length (!)
-#define INTEGRITY_TAG_LEN 16 // The integrity tag len.
-#define ID_LEN 16 // The ID (to find the correct key for this log entry) len.
-#define MAC_LEN 16 // Encrypt then MAC HMAC len.
-#define CIPHERTEXT_LEN (IV_SIZE + MESSAGE_LEN + MAC_LEN)
-#define LOG_LEN (CIPHERTEXT_LEN + INTEGRITY_TAG_LEN + ID_LEN)
+// An entry, which has been encrypted by PrepareLogEntry, but has not been written into the slots yet.
+typedef struct {
+    unsigned char cipher[MAX_CIPHERTEXT_LEN]; // The encrypted message, XORed into every slot.
+    int slots[MAX_K]; // The k distinct slots of the entry.
+    unsigned char tagKey[KEY_SIZE]; // Key of the integrity tags, they depend on the slot content.
+    unsigned char ids[MAX_K][ID_LEN]; // The ID of every slot.
+    unsigned char nextKey[KEY_SIZE]; // The session key after the entry.
+} PreparedLogEntry;
 
 typedef struct {
     unsigned char sessionKey[KEY_SIZE]; // Contains the current session key.
     char *keyPath; // Path to the current seassion key.
+    const char *keyDirectory; // Directory holding the key files.
     const char *logFileDirectory; // Directory holding the log files.
     const char *logFileNamePrefix; // Name of the log file.
     unsigned long maxEntries; // (n) Maximum number of logs the file could hold.
     int m; // m = n * c.
+    LogFileLayout layout; // Message len, slot offsets, k and c of the log file, recorded in its header.
+    int threads; // Number of threads used to write the random pad.
+    int backgroundInit; // Init returns immediately and the random pad is written in the background.
     FILE *logFile; // File pointer of the log file.
-    FILE *keyFile; // File pointer of the session key file.
+    KeyStore *keyStore; // Session key store, the key is written into alternating slots.
+    char *logFilePath; // Path of the log file.
+    PadFiller *padFiller; // Writes the random pad in the background, NULL if the pad is complete.
+    unsigned long entries; // Number of entries in the current log file.
+    const char *segmentPrefix; // Name prefix of the segments, NULL for a single log file.
+    char *segmentName; // Name of the current segment (<segmentPrefix>.<segment>).
+    unsigned long segment; // Index of the current segment.
+    FILE *manifest; // File pointer of the manifest, listing all segments in order.
+    DurabilityMode durability; // When the log file and the key are synced.
+    unsigned long batchSize; // Entries per sync, in the batch mode.
+    long syncIntervalMs; // Time between syncs, in the interval mode.
+    unsigned long pendingEntries; // Key evolutions, which have not been written (and synced) yet.
+    struct timespec lastSync; // Time of the last sync.
+    LatencyHistogram latency; // Latency of AddLogEntry, including the syncs.
+    int useJournal; // Slot writes go through the redo journal, in the entry, batch and interval mode.
+    Journal *journal; // Redo journal of the log file, NULL if it is not used.
+    JournalSlot *stagedSlots; // Slots written since the last commit, they reach the log file after the journal record.
+    int stagedCount; // Number of staged slots.
+    int stagedCapacity; // Capacity of stagedSlots.
+    LogPool *logPool; // Spare log files for SwapLogFile, NULL if every new log file is created on demand. Owned by the context.
+    MessagePacker *packer; // Packs short messages of AddLogMessage into a single entry, NULL writes every message on its own. Owned by the context.
 } PIContext;
 
 /*
@@ -41,19 +74,88 @@ typedef struct {
  * logFilePath: Path to the log file directory.
  * logFilePrefix: Log file name.
  *
- * returns: a new struct of type PIContext, initialized with the requested parameters.
+ * returns: a new struct of type PIContext, initialized with the requested parameters. The layout uses MESSAGE_LEN, K and
+ * C, another layout can be set (InitLogFileLayout, m = SlotCount) before Init.
  */
 PIContext *CreatePIContext(unsigned long n, const char *keyPath, const char *logFilePath, const char* logFilePrefix);
 
+/*
+ * Function: CreateSegmentedPIContext
+ * ----------------------------------
+ * Like CreatePIContext, but the log is split into segments of n entries each. AddLogEntry continues with the next
+ * segment, once the current one is full. Every segment <logFilePrefix>.<index>.log.enc has its own master key
+ * <logFilePrefix>.<index>.masterKey.key, and is listed in the manifest <logFilePrefix>.manifest in the log file directory.
+ *
+ * n : the maximum number of log entries of a single segment.
+ * keyPath : Path to the directory containing the key files.
+ * logFilePath: Path to the log file directory.
+ * logFilePrefix: Name prefix of the segments.
+ *
+ * returns: a new struct of type PIContext, the first segment still has to be initialized by Init.
+ */
+PIContext *CreateSegmentedPIContext(unsigned long n, const char *keyPath, const char *logFilePath, const char *logFilePrefix);
+
 /*
  * Function: Init
  * --------------
- * Based on the provided context a new log file will be created.
+ * Based on the provided context a new log file will be created, starting with its header (message len, n, m, k, c).
+ * If backgroundInit is set, Init returns as soon as the file has been allocated, and the pad is written in the background.
  *
  * ctx: Logger Context.
  */
 void Init(PIContext *ctx);
 
+/*
+ * Function: ResumePIContext
+ * -------------------------
+ * Reopens an existing log file (or the last segment listed in the manifest) and its session key store, without
+ * touching the pad. The number of entries is taken from the key store, a journal is replayed before. The layout, n and
+ * m are taken from the header. A log file without a header has the legacy layout (K, C): m is taken from the file size,
+ * n from the manifest or as the largest n with ceil(n * C) = m.
+ *
+ * keyPath : Path to the directory containing the key files.
+ * logFilePath: Path to the log file directory.
+ * logFilePrefix: Log file name (prefix of the segments).
+ *
+ * returns: a new struct of type PIContext, which has to be continued by Resume.
+ */
+PIContext *ResumePIContext(const char *keyPath, const char *logFilePath, const char *logFilePrefix);
+
+/*
+ * Function: Resume
+ * ----------------
+ * Continues a log file reopened by ResumePIContext, instead of Init. A pad fill, which has been interrupted by a crash,
+ * is continued in the background.
+ *
+ * ctx: Logger Context.
+ */
+void Resume(PIContext *ctx);
+
+/*
+ * Function: SwapLogFile
+ * ---------------------
+ * Makes the pending entries durable, closes the current log file, and continues with a new log file <logFileDirectory><logFilePrefix>.log.enc with a
+ * fresh master key, stored as <keyPath><logFilePrefix>.masterKey.key. The session key file is overwritten.
+ * If a log pool is set, a ready spare is moved into place, otherwise the file is created and initialized like Init.
+ *
+ * ctx: Logger Context.
+ * logFilePrefix: Name of the new log file, has to stay valid as long as the context.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int SwapLogFile(PIContext *ctx, const char *logFilePrefix);
+
+/*
+ * Function: ClosePIContext
+ * ------------------------
+ * Writes the last packed entry, waits for a pending background initialization, makes the pending entries durable, closes all files and frees the context (including its log pool and packer).
+ *
+ * ctx: Logger Context.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int ClosePIContext(PIContext *ctx);
+
 /*
  * Function: AddLogEntry
  * ---------------------
@@ -61,16 +163,91 @@ void Init(PIContext *ctx);
  *
  * ctx:  Logger Context.
  * logMessage: Log message that will be logged.
- * logMessageSize: size of the message, messages longer than the max log legth, will be truncated.
+ * logMessageSize: size of the message, messages longer than the max log legth, will be truncated. A message which
+ * starts with a 0 byte is written as an empty entry (see PlainMessageLength).
+ *
+ * The log file is synced before the key is written, according to the durability mode. With the journal, the changed
+ * slots and the key are appended to the journal instead, which is synced once per commit, and the log file is synced
+ * at the checkpoints. In the batch and interval mode
+ * the key on disk lags behind by the entries of the current batch: after a crash they are lost, and a stolen disk
+ * holds a key which could still forge them. The key in memory evolves after every entry in every mode.
  *
  * returns: 0 on failure and 1 on sucess.
  */
 int AddLogEntry(PIContext *ctx, unsigned char *logMessage, int logMessageSize);
 
+/*
+ * Function: PrepareLogEntry
+ * -------------------------
+ * The first half of AddLogEntry, everything which does not touch the log file: derives the sub keys, encrypts the
+ * message, chooses the slots, creates the IDs and evolves the key. It does not use the context, therefore the next
+ * entries can be prepared (with the next keys) on another thread, while the previous ones are committed.
+ *
+ * key: the session key of the entry, the key after all previously prepared entries.
+ * layout: layout of the log file: longer messages than its message len are truncated, the entry takes k slots.
+ * m: number of slots of the log file.
+ * logMessage: Log message that will be logged.
+ * logMessageSize: size of the message.
+ * entry: will hold the prepared entry.
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int PrepareLogEntry(const unsigned char key[KEY_SIZE], const LogFileLayout *layout, int m, unsigned char *logMessage, int logMessageSize, PreparedLogEntry *entry);
+
+/*
+ * Function: CommitLogEntry
+ * ------------------------
+ * The second half of AddLogEntry: XORs the prepared entry into its slots, writes the tags and takes over the next key,
+ * according to the durability mode. Entries have to be committed in the order they have been prepared, and the
+ * current log file has to have room for the entry (see RollOverLogFile).
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int CommitLogEntry(PIContext *ctx, PreparedLogEntry *entry);
+
+/*
+ * Function: AddLogMessage
+ * -----------------------
+ * Adds the message like AddLogEntry, but with a packer (packed mode) the message is appended to the current packed
+ * entry. The entry is written once it is full, or its timeout has passed when the next message is added; otherwise
+ * FlushLogMessages writes it.
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int AddLogMessage(PIContext *ctx, unsigned char *logMessage, int logMessageSize);
+
+/*
+ * Function: FlushLogMessages
+ * --------------------------
+ * Writes the current packed entry, if there is one.
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int FlushLogMessages(PIContext *ctx);
+
+/*
+ * Function: FlushLogEntries
+ * -------------------------
+ * Makes the pending entries durable now, instead of at the end of the batch or the interval (see AddLogEntry).
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int FlushLogEntries(PIContext *ctx);
+
+/*
+ * Function: RollOverLogFile
+ * -------------------------
+ * Continues with the next segment, if the current one is full. The session key changes, entries prepared before for
+ * the full segment can not be committed anymore.
+ *
+ * returns: 0 on failure and 1 on sucess.
+ */
+int RollOverLogFile(PIContext *ctx);
+
 /*
  * Function: Readkey
  * -----------------
- * Will read the current key from the file.
+ * Will read the current key from the file, a session key store (the newest valid slot) or a plain key file.
  *
  * path: Path to the key file.
  * key: The key will be written here.
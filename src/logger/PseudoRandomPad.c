@@ -0,0 +1,522 @@
+//
+//  PseudoRandomPad.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifdef __linux__
+#define _GNU_SOURCE // fallocate
+#endif
+
+#include "PseudoRandomPad.h"
+#include "PIShared.h"
+#include "Durability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+
+#define SLOT_IOV_MAX 256 // slots per vectored read or write of the split layout, below IOV_MAX.
+
+// shared state of all pad writing threads.
+typedef struct {
+    unsigned char *seed;
+    int fd;
+    const LogFileLayout *layout;
+    unsigned long m;
+    atomic_ulong nextChunk; // index of the next chunk, which is not taken by a thread yet.
+    atomic_int failed;
+} PadJob;
+
+struct PadFiller {
+    unsigned char seed[KEY_SIZE];
+    int fd;
+    LogFileLayout layout;
+    unsigned long m;
+    unsigned long start; // first slot, which has not been padded and synced before.
+    int recover; // slots at or above start could already hold log entries.
+    unsigned char *padded; // bitmap of all slots, which hold their pad (or a log entry) already.
+    unsigned long claimedLow; // lowest slot claimed by PadFillerLoadSlot, which is not durable yet, m for none.
+    pthread_mutex_t lock; // guards the bitmap, and the writes of the background thread.
+    pthread_t thread;
+    char *progressPath;
+    int progressFd;
+    int running; // the background thread has been started.
+    int failed;
+};
+
+static void *padWorker(void *arg);
+static void *padFillerWorker(void *arg);
+static int writeProgress(PadFiller *filler, unsigned long watermark);
+static int needsPad(const unsigned char *slot, const unsigned char *pad, size_t logLen);
+static int splitSlotsIO(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, unsigned char *buffer, int write);
+
+#define IS_PADDED(filler, slot) ((filler)->padded[(slot) / 8] & (1u << ((slot) % 8)))
+#define SET_PADDED(filler, slot) ((filler)->padded[(slot) / 8] |= (1u << ((slot) % 8)))
+
+int PreallocateLogFile(int fd, off_t fileSize)
+{
+#if defined(__APPLE__)
+    // try to get a contiguous allocation first, and fall back to any allocation.
+    fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, fileSize, 0};
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(fd, F_PREALLOCATE, &store); // not fatal, ftruncate still sets the size.
+    }
+#elif defined(__linux__)
+    if (fallocate(fd, 0, 0, fileSize) == 0)
+        return 1;
+    // e.g. not supported by the file system, ftruncate still sets the size.
+#else
+    if (posix_fallocate(fd, 0, fileSize) == 0)
+        return 1;
+#endif
+    if (ftruncate(fd, fileSize) != 0) {
+        fprintf(stderr, "ERROR: Failed to set the log file size: %s\n", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+int WriteLogFileHeader(int fd, const LogFileLayout *layout, unsigned long n, unsigned long m, unsigned char masterKey[KEY_SIZE])
+{
+    unsigned char header[LOG_HEADER_LEN];
+
+    if (layout->slotsOffset == 0) {
+        return 1;
+    }
+
+    int success = EncodeLogFileHeader(layout, n, m, masterKey, header) == 1
+                  && PwriteAll(fd, header, LOG_HEADER_LEN, 0) == 1;
+    memset(header, 0, LOG_HEADER_LEN);
+    return success;
+}
+
+int WritePseudoRandomPad(unsigned char seed[KEY_SIZE], int fd, const LogFileLayout *layout, unsigned long m, int threads)
+{
+    PadJob job = {seed, fd, layout, m, 0, 0};
+    unsigned long chunks = (m + PAD_CHUNK_SLOTS - 1) / PAD_CHUNK_SLOTS;
+
+    if (threads < 1)
+        threads = 1;
+    // no need for more threads than chunks.
+    if ((unsigned long)threads > chunks)
+        threads = (int)(chunks > 0 ? chunks : 1);
+
+    pthread_t workers[threads];
+    int started = 0;
+
+    // the calling thread is the last worker.
+    for (; started < threads - 1; ++started) {
+        if (pthread_create(&workers[started], NULL, padWorker, &job) != 0) {
+            perror("WARNING: Failed to start a pad thread.");
+            break;
+        }
+    }
+
+    padWorker(&job);
+
+    for (int i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+    return atomic_load(&job.failed) ? 0 : 1;
+}
+
+// helper function:
+// takes the next free chunk, generates its pad at the chunks counter offset, and writes it at the chunks file offset.
+static void *padWorker(void *arg)
+{
+    PadJob *job = arg;
+    size_t logLen = job->layout->logLen;
+    unsigned char *buffer = malloc((size_t)PAD_CHUNK_SLOTS * logLen);
+
+    if (buffer == NULL) {
+        perror("ERROR: Failed to allocate the pad buffer.");
+        atomic_store(&job->failed, 1);
+        return NULL;
+    }
+
+    while (!atomic_load(&job->failed)) {
+        unsigned long chunk = atomic_fetch_add(&job->nextChunk, 1);
+        unsigned long firstSlot = chunk * PAD_CHUNK_SLOTS;
+
+        if (firstSlot >= job->m)
+            break;
+
+        unsigned long slots = job->m - firstSlot < PAD_CHUNK_SLOTS ? job->m - firstSlot : PAD_CHUNK_SLOTS;
+
+        if (PRGSlots(job->seed, firstSlot, slots, (int)logLen, buffer) != 1) {
+            perror("ERROR: Creating random PAD.");
+            atomic_store(&job->failed, 1);
+            break;
+        }
+
+        if (PwriteSlots(job->fd, job->layout, firstSlot, slots, buffer) != 1) {
+            perror("ERROR: While writing pseudo random PAD to the file.");
+            atomic_store(&job->failed, 1);
+            break;
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+PadFiller *StartPadFiller(unsigned char seed[KEY_SIZE], int fd, const LogFileLayout *layout, unsigned long m, const char *progressPath, int recover)
+{
+    PadFiller *filler = calloc(1, sizeof(PadFiller));
+    unsigned long progress[2] = {0, m}; // watermark, m
+
+    if (filler == NULL) {
+        perror("ERROR: Failed to allocate memory.");
+        return NULL;
+    }
+
+    memcpy(filler->seed, seed, KEY_SIZE);
+    filler->fd = fd;
+    filler->layout = *layout;
+    filler->m = m;
+    filler->recover = recover;
+    filler->claimedLow = m;
+    filler->padded = calloc((m + 7) / 8, 1);
+    filler->progressPath = strdup(progressPath);
+    filler->progressFd = open(progressPath, O_RDWR | O_CREAT, 0600);
+
+    if (filler->padded == NULL || filler->progressPath == NULL || filler->progressFd == -1) {
+        perror("ERROR: Failed to prepare the background pad fill.");
+        FinishPadFiller(filler);
+        return NULL;
+    }
+
+    if (recover) {
+        // continue at the last synced progress, a missing or broken marker restarts at slot 0.
+        if (PreadAll(filler->progressFd, (unsigned char *)progress, sizeof(progress), 0) == 1 && progress[1] == m && progress[0] <= m) {
+            filler->start = progress[0];
+        }
+        for (unsigned long i = 0; i < filler->start; ++i) {
+            SET_PADDED(filler, i);
+        }
+    }
+
+    if (writeProgress(filler, filler->start) != 1) {
+        perror("ERROR: Failed to write the pad progress marker.");
+        FinishPadFiller(filler);
+        return NULL;
+    }
+
+    pthread_mutex_init(&filler->lock, NULL);
+    if (pthread_create(&filler->thread, NULL, padFillerWorker, filler) != 0) {
+        perror("ERROR: Failed to start the background pad fill.");
+        pthread_mutex_destroy(&filler->lock);
+        FinishPadFiller(filler);
+        return NULL;
+    }
+    filler->running = 1;
+
+    return filler;
+}
+
+int PadFillerLoadSlot(PadFiller *filler, unsigned long slot, unsigned char *buffer)
+{
+    unsigned char pad[MAX_LOG_LEN];
+    size_t logLen = filler->layout.logLen;
+    int padded;
+
+    // claim the slot, the background thread skips it from now on.
+    pthread_mutex_lock(&filler->lock);
+    padded = IS_PADDED(filler, slot) != 0;
+    SET_PADDED(filler, slot);
+    // the pad of the slot is only on disk, once the caller has made its write durable.
+    if (!padded && slot < filler->claimedLow) {
+        filler->claimedLow = slot;
+    }
+    pthread_mutex_unlock(&filler->lock);
+
+    if (padded) {
+        return PreadSlots(filler->fd, &filler->layout, slot, 1, buffer);
+    }
+
+    // materialize the pad of this single slot.
+    if (PRGSlots(filler->seed, slot, 1, (int)logLen, pad) != 1) {
+        return 0;
+    }
+
+    // after a crash the slot could already hold an entry.
+    if (filler->recover && slot >= filler->start) {
+        if (PreadSlots(filler->fd, &filler->layout, slot, 1, buffer) != 1) {
+            return 0;
+        }
+        if (!needsPad(buffer, pad, logLen)) {
+            return 1;
+        }
+    }
+
+    memcpy(buffer, pad, logLen);
+    return 1;
+}
+
+void PadFillerCommit(PadFiller *filler)
+{
+    pthread_mutex_lock(&filler->lock);
+    filler->claimedLow = filler->m;
+    pthread_mutex_unlock(&filler->lock);
+}
+
+int FinishPadFiller(PadFiller *filler)
+{
+    int success;
+
+    if (filler == NULL)
+        return 0;
+
+    if (filler->running) {
+        pthread_join(filler->thread, NULL);
+        pthread_mutex_destroy(&filler->lock);
+    }
+    success = filler->running && !filler->failed;
+
+    if (filler->progressFd != -1) {
+        close(filler->progressFd);
+    }
+    // the marker is kept on failure, to finish the fill later on.
+    if (success) {
+        unlink(filler->progressPath);
+    }
+
+    // erase the master key.
+    memset(filler->seed, 0, KEY_SIZE);
+    free(filler->progressPath);
+    free(filler->padded);
+    free(filler);
+
+    return success;
+}
+
+// helper function:
+// writes the pad chunk by chunk, skipping all slots which have been claimed by PadFillerLoadSlot.
+static void *padFillerWorker(void *arg)
+{
+    PadFiller *filler = arg;
+    size_t logLen = filler->layout.logLen;
+    unsigned char *buffer = malloc((size_t)PAD_CHUNK_SLOTS * logLen);
+    unsigned char *existing = filler->recover ? malloc((size_t)PAD_CHUNK_SLOTS * logLen) : NULL;
+    unsigned long chunk = 0;
+
+    if (buffer == NULL || (filler->recover && existing == NULL)) {
+        perror("ERROR: Failed to allocate the pad buffer.");
+        filler->failed = 1;
+        free(buffer);
+        free(existing);
+        return NULL;
+    }
+
+    for (unsigned long first = filler->start; first < filler->m; first += PAD_CHUNK_SLOTS, ++chunk) {
+        unsigned long slots = filler->m - first < PAD_CHUNK_SLOTS ? filler->m - first : PAD_CHUNK_SLOTS;
+        unsigned long run = 0; // length of the current run of slots, which have to be written.
+
+        if (PRGSlots(filler->seed, first, slots, (int)logLen, buffer) != 1) {
+            perror("ERROR: Creating random PAD.");
+            filler->failed = 1;
+            break;
+        }
+
+        // after a crash, read what is already there, slots which have been written by an entry are skipped.
+        if (existing != NULL && PreadSlots(filler->fd, &filler->layout, first, slots, existing) != 1) {
+            perror("ERROR: Failed to read the log file.");
+            filler->failed = 1;
+            break;
+        }
+
+        pthread_mutex_lock(&filler->lock);
+        for (unsigned long i = 0; i <= slots; ++i) {
+            unsigned long slot = first + i;
+            int write = i < slots && !IS_PADDED(filler, slot)
+                && (existing == NULL || needsPad(existing + i * logLen, buffer + i * logLen, logLen));
+
+            if (i < slots) {
+                SET_PADDED(filler, slot);
+            }
+            if (write) {
+                run++;
+                continue;
+            }
+            // flush the run of slots in front of this slot.
+            if (run > 0 && PwriteSlots(filler->fd, &filler->layout, slot - run, run, buffer + (i - run) * logLen) != 1) {
+                filler->failed = 1;
+            }
+            run = 0;
+        }
+        pthread_mutex_unlock(&filler->lock);
+
+        if (filler->failed) {
+            perror("ERROR: While writing pseudo random PAD to the file.");
+            break;
+        }
+
+        // make the progress durable, the pad has to be on disk before the marker. A claimed slot, which is not durable
+        // yet, could still be zero after a crash, the watermark stays in front of it.
+        if ((chunk + 1) % PAD_PROGRESS_INTERVAL == 0 || first + slots == filler->m) {
+            unsigned long watermark = first + slots;
+
+            if (SyncFile(filler->fd) != 1) {
+                perror("ERROR: Failed to sync the pad progress.");
+                filler->failed = 1;
+                break;
+            }
+            pthread_mutex_lock(&filler->lock);
+            if (filler->claimedLow < watermark) {
+                watermark = filler->claimedLow;
+            }
+            pthread_mutex_unlock(&filler->lock);
+
+            if (writeProgress(filler, watermark) != 1) {
+                perror("ERROR: Failed to sync the pad progress.");
+                filler->failed = 1;
+                break;
+            }
+        }
+    }
+
+    free(buffer);
+    free(existing);
+    return NULL;
+}
+
+// helper function:
+// stores the number of slots, which have been padded and synced.
+static int writeProgress(PadFiller *filler, unsigned long watermark)
+{
+    unsigned long progress[2] = {watermark, filler->m};
+
+    if (PwriteAll(filler->progressFd, (unsigned char *)progress, sizeof(progress), 0) != 1)
+        return 0;
+
+    return SyncFile(filler->progressFd);
+}
+
+// helper function:
+// a slot needs its pad, if every AES block is either still zero (not written) or already the pad (torn pad write).
+// Every block of a slot, which holds a log entry, differs from the pad.
+static int needsPad(const unsigned char *slot, const unsigned char *pad, size_t logLen)
+{
+    static const unsigned char zero[AES_BLOCK_LEN] = {0};
+
+    for (size_t i = 0; i < logLen; i += AES_BLOCK_LEN) {
+        if (memcmp(slot + i, zero, AES_BLOCK_LEN) != 0 && memcmp(slot + i, pad + i, AES_BLOCK_LEN) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int PwriteAll(int fd, const unsigned char *buffer, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t written = pwrite(fd, buffer, size, offset);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        buffer += written;
+        offset += written;
+        size -= written;
+    }
+    return 1;
+}
+
+int PreadAll(int fd, unsigned char *buffer, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t bytesRead = pread(fd, buffer, size, offset);
+
+        if (bytesRead < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        if (bytesRead == 0) {
+            return 0; // end of file
+        }
+        buffer += bytesRead;
+        offset += bytesRead;
+        size -= bytesRead;
+    }
+    return 1;
+}
+
+int PwriteSlots(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, const unsigned char *buffer)
+{
+    if (layout->payloadOffset == 0) {
+        return PwriteAll(fd, buffer, count * layout->logLen, (off_t)SlotOffset(layout, first));
+    }
+    return splitSlotsIO(fd, layout, first, count, (unsigned char *)buffer, 1);
+}
+
+int PreadSlots(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, unsigned char *buffer)
+{
+    if (layout->payloadOffset == 0) {
+        return PreadAll(fd, buffer, count * layout->logLen, (off_t)SlotOffset(layout, first));
+    }
+    return splitSlotsIO(fd, layout, first, count, buffer, 0);
+}
+
+// helper function:
+// reads or writes the payloads and then the tags and IDs of the slots, every part of a slot is an iovec into the buffer.
+// Continues after partial transfers and interrupts, like PwriteAll and PreadAll.
+static int splitSlotsIO(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, unsigned char *buffer, int write)
+{
+    struct iovec iov[SLOT_IOV_MAX];
+    const size_t cipherLen = layout->logLen - SLOT_META_LEN;
+
+    for (int part = 0; part < 2; ++part) {
+        size_t start = part == 0 ? 0 : cipherLen;
+        size_t length = part == 0 ? cipherLen : SLOT_META_LEN;
+
+        for (unsigned long done = 0; done < count;) {
+            int slots = (int)(count - done < SLOT_IOV_MAX ? count - done : SLOT_IOV_MAX);
+            off_t offset = (off_t)(part == 0 ? PayloadOffset(layout, first + done) : MetaOffset(layout, first + done));
+            int next = 0;
+
+            for (int i = 0; i < slots; ++i) {
+                iov[i].iov_base = buffer + (done + i) * layout->logLen + start;
+                iov[i].iov_len = length;
+            }
+
+            while (next < slots) {
+                ssize_t transferred = write ? pwritev(fd, iov + next, slots - next, offset) : preadv(fd, iov + next, slots - next, offset);
+
+                if (transferred < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return 0;
+                }
+                if (transferred == 0) {
+                    return 0; // end of file
+                }
+                offset += transferred;
+                while (transferred > 0) {
+                    if ((size_t)transferred >= iov[next].iov_len) {
+                        transferred -= iov[next].iov_len;
+                        next++;
+                    } else {
+                        iov[next].iov_base = (unsigned char *)iov[next].iov_base + transferred;
+                        iov[next].iov_len -= transferred;
+                        transferred = 0;
+                    }
+                }
+            }
+            done += slots;
+        }
+    }
+    return 1;
+}
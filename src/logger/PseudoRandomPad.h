@@ -0,0 +1,159 @@
+//
+//  PseudoRandomPad.h
+//  logger
+//  Creates the pseudo random pad of a log file. Every slot i of the pad starts at the PRG counter i * logLen / AES_BLOCK_LEN,
+//  therefore the pad can be generated in independent chunks, which are written with positional I/O. The header of the log
+//  file is not part of the pad, in the split layout the pad of a slot is split like the slot.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef PseudoRandomPad_h
+#define PseudoRandomPad_h
+
+#include <sys/types.h>
+#include "Crypto.h"
+#include "PIShared.h"
+
+#define PAD_CHUNK_SLOTS 1024 // number of slots generated and written at once (~1 MB).
+#define PAD_PROGRESS_INTERVAL 64 // number of chunks after which the background fill syncs the file and its progress marker.
+#define PAD_PROGRESS_EXTENSION ".pad" // extension of the progress marker, appended to the log file path.
+
+// Fills the pad of a log file in the background, while log entries are already added.
+typedef struct PadFiller PadFiller;
+
+/*
+ * Function: PreallocateLogFile
+ * ----------------------------
+ * Reserves the requested size for the log file and sets the file size, without writing any data.
+ *
+ * fd: file descriptor of the log file.
+ * fileSize: the requested file size.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PreallocateLogFile(int fd, off_t fileSize);
+
+/*
+ * Function: WriteLogFileHeader
+ * ----------------------------
+ * Writes the header of a new log file (see EncodeLogFileHeader), a log file of the legacy layout has none.
+ *
+ * fd: file descriptor of the log file.
+ * layout: layout of the log file.
+ * n: max number of entries.
+ * m: number of slots within the log file.
+ * masterKey: the master key (k0) of the log file, authenticates the header.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int WriteLogFileHeader(int fd, const LogFileLayout *layout, unsigned long n, unsigned long m, unsigned char masterKey[KEY_SIZE]);
+
+/*
+ * Function: WritePseudoRandomPad
+ * ------------------------------
+ * Writes the pseudo random pad of all m slots into the log file, by using the requested amount of threads.
+ * The result is identical to a sequential PRG with logLen bytes per call.
+ *
+ * seed: the seed of the pad (the master key).
+ * fd: file descriptor of the log file.
+ * layout: layout of the log file.
+ * m: number of slots within the log file.
+ * threads: number of threads, values smaller than 1 will use a single thread.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int WritePseudoRandomPad(unsigned char seed[KEY_SIZE], int fd, const LogFileLayout *layout, unsigned long m, int threads);
+
+/*
+ * Function: StartPadFiller
+ * ------------------------
+ * Starts a background thread, which writes the pad sequentially into the (preallocated) log file.
+ * The progress is stored in the progress marker, every PAD_PROGRESS_INTERVAL chunks, after the pad has been synced.
+ * While the filler is running, slots have to be read through PadFillerLoadSlot.
+ * Note: the seed (master key) is held in memory until the fill has been finished.
+ *
+ * seed: the seed of the pad (the master key).
+ * fd: file descriptor of the log file.
+ * layout: layout of the log file.
+ * m: number of slots within the log file.
+ * progressPath: path of the progress marker.
+ * recover: 0 for a new log file, 1 to finish the fill of an existing log file after a crash. The fill will continue at the
+ *          stored progress, slots which hold log entries already are detected and kept.
+ *
+ * returns: the filler or NULL on failure.
+ */
+PadFiller *StartPadFiller(unsigned char seed[KEY_SIZE], int fd, const LogFileLayout *layout, unsigned long m, const char *progressPath, int recover);
+
+/*
+ * Function: PadFillerLoadSlot
+ * ---------------------------
+ * Loads the current content of a slot. A slot which has not been padded yet, will be materialized from the seed,
+ * and will not be touched by the background thread afterwards.
+ *
+ * filler: the pad filler.
+ * slot: the slot index.
+ * buffer: will hold the slot, of the size logLen.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PadFillerLoadSlot(PadFiller *filler, unsigned long slot, unsigned char *buffer);
+
+/*
+ * Function: PadFillerCommit
+ * -------------------------
+ * Tells the filler, that the writes of all slots claimed by PadFillerLoadSlot so far are durable (synced or journaled).
+ * Until then, the progress marker stays in front of the lowest claimed slot, whose pad is only held by the caller.
+ *
+ * filler: the pad filler.
+ */
+void PadFillerCommit(PadFiller *filler);
+
+/*
+ * Function: FinishPadFiller
+ * -------------------------
+ * Waits until the whole pad has been written, removes the progress marker, and frees the filler.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int FinishPadFiller(PadFiller *filler);
+
+/*
+ * Function: PwriteAll
+ * -------------------
+ * pwrite, which continues after partial writes and interrupts.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PwriteAll(int fd, const unsigned char *buffer, size_t size, off_t offset);
+
+/*
+ * Function: PreadAll
+ * ------------------
+ * pread, which continues after partial reads and interrupts. Reading behind the end of the file is a failure.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PreadAll(int fd, unsigned char *buffer, size_t size, off_t offset);
+
+/*
+ * Function: PwriteSlots
+ * ---------------------
+ * Writes count consecutive slots, starting at the slot first. The buffer holds every slot as XOR | T | ID (logLen
+ * bytes), in the split layout the parts are written into their regions with a vectored write each.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PwriteSlots(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, const unsigned char *buffer);
+
+/*
+ * Function: PreadSlots
+ * --------------------
+ * Reads count consecutive slots, starting at the slot first, as XOR | T | ID (see PwriteSlots).
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PreadSlots(int fd, const LogFileLayout *layout, unsigned long first, unsigned long count, unsigned char *buffer);
+
+#endif /* PseudoRandomPad_h */
@@ -0,0 +1,406 @@
+//
+//  ShmRing.c
+//  logger
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "ShmRing.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define SHM_RING_MAGIC 0x474E5250 // "PRNG"
+#define SHM_RING_VERSION 2
+#define CACHE_LINE 64
+#define PUBLISH_SPINS 1000 // polls of a claimed slot, before the writer sleeps.
+#define MAX_WAIT_MS 1000 // the stop flag is checked at least this often, a signal may be taken by another thread.
+
+// the slot at position pos is free for the producer if sequence == pos, and ready for the writer if sequence == pos + 1.
+// The writer hands it back for the next round with sequence = pos + capacity.
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t sequence;
+    _Atomic int32_t pid; // producer, which has claimed the slot, 0 until it is known.
+    uint32_t length;
+    unsigned char data[MAX_MESSAGE_LEN];
+} ShmRingSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t slotSize;
+    uint32_t messageLen; // message len of the log file, longer messages are truncated.
+    _Atomic uint32_t closed; // the writer has stopped.
+    _Alignas(CACHE_LINE) _Atomic uint64_t head; // next position, claimed by a producer.
+    _Alignas(CACHE_LINE) _Atomic uint32_t wakeSequence; // futex word, incremented to wake the writer.
+    _Atomic uint32_t writerWaiting; // the writer sleeps (or is about to), producers have to wake it.
+    _Alignas(CACHE_LINE) ShmRingSlot slots[];
+} ShmRingHeader;
+
+struct ShmRingProducer {
+    ShmRingHeader *ring;
+    size_t size;
+    uint64_t reserved; // position of the reserved slot.
+    int32_t pid;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// Prototype decleration
+static ShmRingHeader *mapRing(int fd, size_t size);
+static int slotAbandoned(ShmRingSlot *slot, struct timespec *stalledSince);
+static void waitForProducers(ShmRingHeader *ring, uint32_t wakeSequence, int timeoutMs);
+static void wakeWriter(ShmRingHeader *ring);
+static long elapsedMs(struct timespec *since);
+static void handleSignal(int signal);
+
+int RunShmRingWriter(PIContext *ctx, const char *name, unsigned long slots, unsigned long maxEntries, unsigned long *written)
+{
+    size_t size = sizeof(ShmRingHeader) + slots * sizeof(ShmRingSlot);
+    const uint32_t messageLen = (uint32_t)ctx->layout.messageLen; // the copy in the ring is writable by the producers.
+    struct sigaction action = {0};
+    struct timespec stalledSince = {0};
+    unsigned long abandoned = 0;
+    uint64_t tail = 0;
+    int dirty = 0, failed = 0, spins = 0, fd;
+    ShmRingHeader *ring;
+
+    *written = 0;
+
+    if (slots == 0 || (slots & (slots - 1)) != 0) {
+        fprintf(stderr, "ERROR: The number of ring slots has to be a power of two.\n");
+        return 0;
+    }
+
+    // no SA_RESTART, the signals interrupt the futex wait.
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // a ring of a previous run is replaced, its producers see it closed.
+    shm_unlink(name);
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) == -1
+        || ftruncate(fd, (off_t)size) != 0
+        || (ring = mapRing(fd, size)) == NULL) {
+        perror("ERROR: Failed to create the shared memory ring.");
+        if (fd != -1) {
+            close(fd);
+            shm_unlink(name);
+        }
+        return 0;
+    }
+    close(fd);
+
+    ring->capacity = slots;
+    ring->slotSize = sizeof(ShmRingSlot);
+    ring->messageLen = messageLen;
+    for (unsigned long i = 0; i < slots; ++i) {
+        atomic_store_explicit(&ring->slots[i].sequence, i, memory_order_relaxed);
+    }
+    ring->version = SHM_RING_VERSION;
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SHM_RING_MAGIC;
+    printf("INFO: Shared memory ring %s with %lu slots.\n", name, slots);
+
+    while (!stopRequested && *written < maxEntries) {
+        ShmRingSlot *slot = &ring->slots[tail & (slots - 1)];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+        if (sequence == tail + 1) {
+            // the slot is writable by the producer, its length is read once and clamped.
+            uint32_t length = *(volatile uint32_t *)&slot->length;
+            if (length > messageLen) {
+                length = messageLen;
+            }
+
+            // the message is added (or packed) straight from the shared slot.
+            if (AddLogMessage(ctx, slot->data, (int)length) != 1) {
+                failed = 1;
+                break;
+            }
+            (*written)++;
+            dirty = 1;
+
+            memset(slot->data, 0, messageLen);
+            atomic_store_explicit(&slot->pid, 0, memory_order_relaxed);
+            atomic_store_explicit(&slot->sequence, tail + slots, memory_order_release);
+            tail++;
+            stalledSince.tv_sec = 0;
+            spins = 0;
+            continue;
+        }
+
+        // the slot has been claimed, but not published yet. The producer is usually about to publish it.
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) > tail) {
+            if (++spins < PUBLISH_SPINS) {
+                continue;
+            }
+            if (slotAbandoned(slot, &stalledSince)) {
+                // a late publish of the producer fails, the sequence is not pos anymore.
+                uint64_t expected = tail;
+                if (atomic_compare_exchange_strong_explicit(&slot->sequence, &expected, tail + slots, memory_order_acq_rel, memory_order_acquire)) {
+                    atomic_store_explicit(&slot->pid, 0, memory_order_relaxed);
+                    abandoned++;
+                    tail++;
+                    stalledSince.tv_sec = 0;
+                    spins = 0;
+                }
+                continue;
+            }
+            waitForProducers(ring, atomic_load_explicit(&ring->wakeSequence, memory_order_acquire), 1);
+            continue;
+        }
+
+        // the ring is empty, pending entries are made durable once it has been idle for a while.
+        uint32_t wakeSequence = atomic_load_explicit(&ring->wakeSequence, memory_order_acquire);
+        atomic_store_explicit(&ring->writerWaiting, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&ring->head, memory_order_seq_cst) == tail) {
+            struct timespec before;
+            clock_gettime(CLOCK_MONOTONIC, &before);
+            int timeoutMs = dirty ? SHM_RING_IDLE_MS : MAX_WAIT_MS;
+            long packRemaining = ctx->packer != NULL ? PackerRemainingMs(ctx->packer) : -1;
+            if (packRemaining >= 0 && packRemaining < timeoutMs) {
+                timeoutMs = (int)packRemaining;
+            }
+            waitForProducers(ring, wakeSequence, timeoutMs);
+
+            // a packed entry is written once it is due, also while the ring stays empty.
+            if (ctx->packer != NULL && PackerRemainingMs(ctx->packer) == 0) {
+                if (FlushLogMessages(ctx) != 1) {
+                    failed = 1;
+                    atomic_store_explicit(&ring->writerWaiting, 0, memory_order_relaxed);
+                    break;
+                }
+                dirty = 1;
+            }
+            if (dirty && atomic_load_explicit(&ring->head, memory_order_acquire) == tail && elapsedMs(&before) >= SHM_RING_IDLE_MS) {
+                if (FlushLogEntries(ctx) != 1) {
+                    failed = 1;
+                    atomic_store_explicit(&ring->writerWaiting, 0, memory_order_relaxed);
+                    break;
+                }
+                dirty = 0;
+            }
+        }
+        atomic_store_explicit(&ring->writerWaiting, 0, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    printf("INFO: %lu messages written, %lu abandoned slots skipped.\n", *written, abandoned);
+
+    munmap(ring, size);
+    shm_unlink(name);
+    return !failed;
+}
+
+ShmRingProducer *OpenShmRingProducer(const char *name)
+{
+    ShmRingProducer *producer = calloc(1, sizeof(ShmRingProducer));
+    struct stat st;
+    int fd;
+
+    if (producer == NULL) {
+        return NULL;
+    }
+
+    if ((fd = shm_open(name, O_RDWR, 0)) == -1 || fstat(fd, &st) != 0
+        || (size_t)st.st_size < sizeof(ShmRingHeader)
+        || (producer->ring = mapRing(fd, (size_t)st.st_size)) == NULL) {
+        if (fd != -1) {
+            close(fd);
+        }
+        free(producer);
+        return NULL;
+    }
+    close(fd);
+
+    producer->size = (size_t)st.st_size;
+    producer->pid = (int32_t)getpid();
+
+    // the writer fills in the header after the ring has been created.
+    if (producer->ring->magic != SHM_RING_MAGIC || producer->ring->version != SHM_RING_VERSION
+        || producer->ring->slotSize != sizeof(ShmRingSlot) || producer->ring->messageLen > MAX_MESSAGE_LEN
+        || sizeof(ShmRingHeader) + producer->ring->capacity * sizeof(ShmRingSlot) > producer->size) {
+        fprintf(stderr, "ERROR: The shared memory ring is not ready or incompatible.\n");
+        CloseShmRingProducer(producer);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    return producer;
+}
+
+unsigned char *ShmRingReserve(ShmRingProducer *producer)
+{
+    ShmRingHeader *ring = producer->ring;
+    uint64_t mask = ring->capacity - 1;
+    uint64_t position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ShmRingSlot *slot;
+
+    if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+        return NULL;
+    }
+
+    for (;;) {
+        slot = &ring->slots[position & mask];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t difference = (int64_t)(sequence - position);
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &position, position + 1, memory_order_acq_rel, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // the writer has not handed the slot back yet, the ring is full.
+            return NULL;
+        } else {
+            position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+
+    atomic_store_explicit(&slot->pid, producer->pid, memory_order_release);
+    producer->reserved = position;
+    return slot->data;
+}
+
+int ShmRingPublish(ShmRingProducer *producer, size_t length)
+{
+    ShmRingHeader *ring = producer->ring;
+    ShmRingSlot *slot = &ring->slots[producer->reserved & (ring->capacity - 1)];
+    uint64_t expected = producer->reserved;
+
+    slot->length = (uint32_t)(length > ring->messageLen ? ring->messageLen : length);
+    if (!atomic_compare_exchange_strong_explicit(&slot->sequence, &expected, producer->reserved + 1, memory_order_release, memory_order_relaxed)) {
+        return 0;
+    }
+
+    wakeWriter(ring);
+    return 1;
+}
+
+int ShmRingSubmit(ShmRingProducer *producer, const unsigned char *message, size_t length)
+{
+    unsigned char *buffer = ShmRingReserve(producer);
+
+    if (buffer == NULL) {
+        return ShmRingClosed(producer) ? -1 : 0;
+    }
+
+    if (length > producer->ring->messageLen) {
+        length = producer->ring->messageLen;
+    }
+    memcpy(buffer, message, length);
+    return ShmRingPublish(producer, length);
+}
+
+int ShmRingClosed(ShmRingProducer *producer)
+{
+    return atomic_load_explicit(&producer->ring->closed, memory_order_acquire) != 0;
+}
+
+void CloseShmRingProducer(ShmRingProducer *producer)
+{
+    if (producer == NULL) {
+        return;
+    }
+
+    munmap(producer->ring, producer->size);
+    free(producer);
+}
+
+// helper function:
+// maps the shared memory object.
+static ShmRingHeader *mapRing(int fd, size_t size)
+{
+    void *ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return ring == MAP_FAILED ? NULL : ring;
+}
+
+// helper function:
+// a claimed slot is abandoned, if its producer does not exist anymore. If the producer died before it stored its pid,
+// the slot is abandoned after SHM_RING_CLAIM_TIMEOUT_MS.
+static int slotAbandoned(ShmRingSlot *slot, struct timespec *stalledSince)
+{
+    int32_t pid = atomic_load_explicit(&slot->pid, memory_order_acquire);
+
+    if (stalledSince->tv_sec == 0) {
+        clock_gettime(CLOCK_MONOTONIC, stalledSince);
+    }
+
+    if (pid != 0) {
+        return kill(pid, 0) == -1 && errno == ESRCH;
+    }
+
+    return elapsedMs(stalledSince) >= SHM_RING_CLAIM_TIMEOUT_MS;
+}
+
+// helper function:
+// sleeps until a producer increments the wake sequence, or the timeout has passed.
+static void waitForProducers(ShmRingHeader *ring, uint32_t wakeSequence, int timeoutMs)
+{
+#ifdef __linux__
+    struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+
+    // the futex is shared between processes, FUTEX_WAIT (not FUTEX_WAIT_PRIVATE).
+    syscall(SYS_futex, &ring->wakeSequence, FUTEX_WAIT, wakeSequence, &timeout, NULL, 0);
+#else
+    // there is no public futex, the writer polls with a backoff up to 1 ms.
+    static long backoffUs = 1;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (atomic_load_explicit(&ring->wakeSequence, memory_order_acquire) == wakeSequence && !stopRequested
+           && elapsedMs(&start) < timeoutMs) {
+        usleep((useconds_t)backoffUs);
+        backoffUs = backoffUs < 1000 ? backoffUs * 2 : 1000;
+    }
+    if (atomic_load_explicit(&ring->wakeSequence, memory_order_acquire) != wakeSequence) {
+        backoffUs = 1;
+    }
+#endif
+}
+
+// helper function:
+// wakes the writer, if it sleeps.
+static void wakeWriter(ShmRingHeader *ring)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->writerWaiting, memory_order_seq_cst)) {
+        atomic_fetch_add_explicit(&ring->wakeSequence, 1, memory_order_release);
+#ifdef __linux__
+        syscall(SYS_futex, &ring->wakeSequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+// helper function:
+// milliseconds since the given time.
+static long elapsedMs(struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+// helper function:
+// SIGINT and SIGTERM stop the writer.
+static void handleSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
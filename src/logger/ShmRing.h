@@ -0,0 +1,96 @@
+//
+//  ShmRing.h
+//  logger
+//  Shared memory ring, through which many processes submit log messages to a single writer, which owns the PIContext.
+//  The ring holds a fixed number of MAX_MESSAGE_LEN slots, every slot carries a sequence number: a producer claims the next
+//  free slot with a single compare and swap, writes the message directly into the shared slot and publishes it by
+//  advancing the sequence. The writer adds the message straight from the slot and hands the slot back. A sleeping
+//  writer is woken with a futex on Linux, elsewhere it polls with a backoff. A producer which dies after claiming a
+//  slot does not block the ring: the writer skips the slot, once the producer is gone.
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef ShmRing_h
+#define ShmRing_h
+
+#include "PI.h"
+
+#define SHM_RING_DEFAULT_SLOTS 1024 // number of slots, a power of two.
+#define SHM_RING_CLAIM_TIMEOUT_MS 1000 // a claimed slot without the pid of its producer is skipped after this time.
+#define SHM_RING_IDLE_MS 50 // idle time, after which the pending entries are made durable.
+
+typedef struct ShmRingProducer ShmRingProducer;
+
+/*
+ * Function: RunShmRingWriter
+ * --------------------------
+ * Creates the shared memory ring (shm_open) and adds every submitted message as a log entry, in the order the slots
+ * have been claimed, until SIGINT or SIGTERM is received, maxEntries entries have been added or an entry can not be
+ * added. A ring of a previous run is replaced. The log file (or the current segment) has to be initialized.
+ *
+ * ctx: Logger Context.
+ * name: name of the shared memory object, starting with a slash.
+ * slots: number of slots, a power of two.
+ * maxEntries: maximum number of messages to add.
+ * written: will hold the number of added messages (entries, unless they are packed), also on failure.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int RunShmRingWriter(PIContext *ctx, const char *name, unsigned long slots, unsigned long maxEntries, unsigned long *written);
+
+/*
+ * Function: OpenShmRingProducer
+ * -----------------------------
+ * Maps the ring of a running writer into the producer process.
+ *
+ * returns: the producer or NULL on failure.
+ */
+ShmRingProducer *OpenShmRingProducer(const char *name);
+
+/*
+ * Function: ShmRingReserve
+ * ------------------------
+ * Claims the next free slot, the message is written directly into the returned buffer of MAX_MESSAGE_LEN bytes and
+ * submitted by ShmRingPublish. A producer holds at most one slot at a time.
+ *
+ * returns: the buffer of the slot, NULL if the ring is full or the writer has stopped (see ShmRingClosed).
+ */
+unsigned char *ShmRingReserve(ShmRingProducer *producer);
+
+/*
+ * Function: ShmRingPublish
+ * ------------------------
+ * Submits the message in the reserved slot.
+ *
+ * length: length of the message, a message longer than the message len of the log file is truncated.
+ *
+ * returns: 0 if the writer has skipped the slot (the producer stalled longer than SHM_RING_CLAIM_TIMEOUT_MS), 1 on success.
+ */
+int ShmRingPublish(ShmRingProducer *producer, size_t length);
+
+/*
+ * Function: ShmRingSubmit
+ * -----------------------
+ * Copies the message into the next free slot and submits it, longer messages are truncated.
+ *
+ * returns: -1 if the writer has stopped, 0 if the ring is full and 1 on success.
+ */
+int ShmRingSubmit(ShmRingProducer *producer, const unsigned char *message, size_t length);
+
+/*
+ * Function: ShmRingClosed
+ * -----------------------
+ * returns: 1 if the writer of the ring has stopped, the producer has to be reopened for a new writer.
+ */
+int ShmRingClosed(ShmRingProducer *producer);
+
+/*
+ * Function: CloseShmRingProducer
+ * ------------------------------
+ * Unmaps the ring.
+ */
+void CloseShmRingProducer(ShmRingProducer *producer);
+
+#endif /* ShmRing_h */
@@ -3,7 +3,8 @@
 //  logger
 //  This file is the entry point of the log creation part, it aims to simulate the log creation process.
 //  It first calls the Init (initialization) methods, which creates the log file of the requested size.
-//  Second, AddLogEntry (add item) will be called for every single log entry in the provided log file.
+//  Second, AddLogEntry (add item) will be called for every single log entry in the provided log file, which is streamed
+//  (from a file, stdin or a FIFO) with a fixed amount of memory.
 //  This file contains a lot of less important helper methods for parsing arguments, and providing the logs.
 //
 //  Copyright © 2023 Airbus Commercial Aircraft
@@ -16,11 +17,11 @@
 #include <time.h>
 #include "PI.h"
 #include "LoggerContext.h"
-
-#define MAX_LINE_LENGTH MESSAGE_LEN // length of the define max log legnth
+#include "LogStream.h"
+#include "LogServer.h"
+#include "ShmRing.h"
 
 LoggerContext parseArgs(int argc, const char * argv[]);
-char **readLogs(const char *path, int *logCount, int maxlogCount);
 
 int main(int argc, const char * argv[]) {
     struct timespec start, end;
@@ -28,24 +29,90 @@ int main(int argc, const char * argv[]) {
     
     // parse the provided arguments into the context struct.
     LoggerContext loggerCtx = parseArgs(argc, argv);
-    int logCount;
-    // read the logs from the provided log file.
-    char **logs = readLogs(loggerCtx.logPath, &logCount, loggerCtx.maxLogs);
+    unsigned long logCount;
+    // open the logs, they are read while they are written. "-" reads stdin.
+    FILE *input = NULL;
+    if (loggerCtx.logPath != NULL && (input = strcmp(loggerCtx.logPath, "-") == 0 ? stdin : fopen(loggerCtx.logPath, "r")) == NULL) {
+        perror("ERROR: opening log file\n");
+        exit(EXIT_FAILURE);
+    }
     
     // Create a Logger Context struct, which contains all important information, like the maxmum number of log files.
-    PIContext *ctx = CreatePIContext(logCount, loggerCtx.outputPath, loggerCtx.outputPath, loggerCtx.logFileName);
+    PIContext *ctx;
+    if (loggerCtx.resume) {
+        ctx = ResumePIContext(loggerCtx.outputPath, loggerCtx.outputPath, loggerCtx.logFileName);
+    } else if (loggerCtx.segmentSize > 0) {
+        ctx = CreateSegmentedPIContext(loggerCtx.segmentSize, loggerCtx.outputPath, loggerCtx.outputPath, loggerCtx.logFileName);
+    } else {
+        ctx = CreatePIContext(loggerCtx.maxLogs, loggerCtx.outputPath, loggerCtx.outputPath, loggerCtx.logFileName);
+    }
+    if (loggerCtx.threads > 0) {
+        ctx->threads = loggerCtx.threads;
+    }
+    ctx->backgroundInit = loggerCtx.backgroundInit;
+    ctx->durability = loggerCtx.durability;
+    ctx->useJournal = loggerCtx.journal;
+    if (loggerCtx.batchSize > 0) {
+        ctx->batchSize = loggerCtx.batchSize;
+    }
+    if (loggerCtx.syncIntervalMs > 0) {
+        ctx->syncIntervalMs = loggerCtx.syncIntervalMs;
+    }
+    if (!loggerCtx.resume && (loggerCtx.messageLen > 0 || loggerCtx.k > 0 || loggerCtx.c > 0)) {
+        // a resumed log file keeps the layout of its header.
+        InitLogFileLayout(&ctx->layout, loggerCtx.messageLen > 0 ? loggerCtx.messageLen : MESSAGE_LEN,
+                          loggerCtx.k > 0 ? loggerCtx.k : K, loggerCtx.c > 0 ? loggerCtx.c : C);
+        ctx->m = (int)SlotCount(&ctx->layout, ctx->maxEntries);
+    }
+    if (!loggerCtx.resume && loggerCtx.splitLayout) {
+        // the tags and IDs are stored apart from the payloads, sized for the m slots of every log file.
+        SplitLogFileLayout(&ctx->layout, ctx->m);
+    }
     
-    // Call the init algorithm.
-    // This will initialize the log file of the according size, and will write the pseudo random pad.
-    Init(ctx);
+    if (loggerCtx.resume) {
+        // The existing log file is continued with its current key, nothing is rewritten.
+        Resume(ctx);
+        if (ctx->segmentPrefix == NULL) {
+            printf("INFO: %lu entries left in the log file.\n", ctx->maxEntries - ctx->entries);
+        }
+    } else {
+        // Call the init algorithm.
+        // This will initialize the log file of the according size, and will write the pseudo random pad.
+        Init(ctx);
+    }
+    
+    if (loggerCtx.pack) {
+        // Short messages share an entry, the verifier splits them again.
+        if ((ctx->packer = malloc(sizeof(MessagePacker))) == NULL) {
+            perror("ERROR: Failed to allocate the message packer.");
+            exit(EXIT_FAILURE);
+        }
+        InitMessagePacker(ctx->packer, ctx->layout.messageLen, loggerCtx.packTimeoutMs > 0 ? loggerCtx.packTimeoutMs : DEFAULT_PACK_TIMEOUT_MS);
+    }
+    
+    // The next segments are padded in the background, while the current one is filled.
+    if (loggerCtx.spares > 0 && (ctx->logPool = CreateLogPool(loggerCtx.outputPath, loggerCtx.logFileName, &ctx->layout, ctx->maxEntries, ctx->m, loggerCtx.spares, 1)) == NULL) {
+        fprintf(stderr, "ERROR: Failed to create the log pool\n");
+        exit(EXIT_FAILURE);
+    }
     
     
     clock_gettime(CLOCK_MONOTONIC, &start);
-    for (int i = 0; i < logCount; ++i) {
-        // Pass the modified string to AddLogEntry (add item).
-        AddLogEntry(ctx, (unsigned char *)logs[i], (int)strlen(logs[i]));
+    int streamed;
+    if (loggerCtx.socketPath != NULL) {
+        // Every message of the local clients is passed to AddLogMessage (add item), until the logger is stopped.
+        streamed = RunLogServer(ctx, loggerCtx.socketPath, loggerCtx.maxLogs, &logCount);
+    } else if (loggerCtx.shmName != NULL) {
+        // Every message submitted through the shared memory ring is passed to AddLogMessage (add item).
+        streamed = RunShmRingWriter(ctx, loggerCtx.shmName, loggerCtx.shmSlots > 0 ? loggerCtx.shmSlots : SHM_RING_DEFAULT_SLOTS, loggerCtx.maxLogs, &logCount);
+    } else {
+        // Every line is passed to AddLogEntry (add item), split into its encryption and its slot writes.
+        streamed = StreamLogEntries(ctx, input, loggerCtx.maxLogs, DEFAULT_STREAM_QUEUE_DEPTH, &logCount);
     }
     clock_gettime(CLOCK_MONOTONIC, &end);
+    if (input != NULL && input != stdin) {
+        fclose(input);
+    }
     
     
     // print execution time:
@@ -61,17 +128,18 @@ int main(int argc, const char * argv[]) {
     printf("Execution time: %ld seconds and %ld nanoseconds\n", seconds, nanoseconds);
 
     printf("Execution time: %ld seconds\n", seconds);
-    printf("%d Logs has been written.", logCount);
+    printf("%lu Logs has been written.\n", logCount);
     
-    fclose(ctx->logFile);
-    fclose(ctx->keyFile);
-    free(ctx);
-    return 0;
+    // print what the durability mode costs per entry.
+    printf("Durability mode: %s\n", DurabilityModeName(ctx->durability));
+    PrintLatencyHistogram(&ctx->latency, stdout);
+    
+    return ClosePIContext(ctx) && streamed ? 0 : EXIT_FAILURE;
 }
 
 
 LoggerContext parseArgs(int argc, const char * argv[]) {
-    LoggerContext ctx = {NULL, NULL, "test", INT_MAX};
+    LoggerContext ctx = {NULL, NULL, "test", INT_MAX, 0, 0, 0, 0, DURABILITY_NONE, 0, 0, 0, 0, NULL, NULL, 0, 0, 0, 0, 0, 0, 0};
 
     for (int i = 1; i < argc; i++) {
         if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
@@ -86,77 +154,116 @@ LoggerContext parseArgs(int argc, const char * argv[]) {
                 fprintf(stderr, "ERROR: Invalid number of maximum logs\n");
                 exit(EXIT_FAILURE);
             }
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) && i + 1 < argc) {
+            ctx.threads = atoi(argv[++i]);
+            if (ctx.threads <= 0) {
+                fprintf(stderr, "ERROR: Invalid number of threads\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--background-init") == 0) {
+            ctx.backgroundInit = 1;
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--segment") == 0) && i + 1 < argc) {
+            ctx.segmentSize = atoi(argv[++i]);
+            if (ctx.segmentSize <= 0) {
+                fprintf(stderr, "ERROR: Invalid segment size\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--spares") == 0) && i + 1 < argc) {
+            ctx.spares = atoi(argv[++i]);
+            if (ctx.spares <= 0) {
+                fprintf(stderr, "ERROR: Invalid number of spares\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--durability") == 0) && i + 1 < argc) {
+            if (ParseDurabilityMode(argv[++i], &ctx.durability) != 1) {
+                fprintf(stderr, "ERROR: Invalid durability mode, use none, entry, batch or interval\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+            ctx.batchSize = atoi(argv[++i]);
+            if (ctx.batchSize <= 0) {
+                fprintf(stderr, "ERROR: Invalid batch size\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--sync-interval") == 0 && i + 1 < argc) {
+            ctx.syncIntervalMs = atoi(argv[++i]);
+            if (ctx.syncIntervalMs <= 0) {
+                fprintf(stderr, "ERROR: Invalid sync interval\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--journal") == 0) {
+            ctx.journal = 1;
+        } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--resume") == 0) {
+            ctx.resume = 1;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            ctx.socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            ctx.shmName = argv[++i];
+        } else if (strcmp(argv[i], "--shm-slots") == 0 && i + 1 < argc) {
+            ctx.shmSlots = strtoul(argv[++i], NULL, 10);
+            if (ctx.shmSlots == 0 || (ctx.shmSlots & (ctx.shmSlots - 1)) != 0) {
+                fprintf(stderr, "ERROR: The number of ring slots has to be a power of two\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--pack") == 0) {
+            ctx.pack = 1;
+        } else if (strcmp(argv[i], "--pack-timeout") == 0 && i + 1 < argc) {
+            ctx.packTimeoutMs = atoi(argv[++i]);
+            if (ctx.packTimeoutMs <= 0) {
+                fprintf(stderr, "ERROR: Invalid pack timeout\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--message-len") == 0 && i + 1 < argc) {
+            ctx.messageLen = atoi(argv[++i]);
+            if (!IsValidMessageLen(ctx.messageLen)) {
+                fprintf(stderr, "ERROR: Invalid message len, a power of two from %d to %d\n", MIN_MESSAGE_LEN, MAX_MESSAGE_LEN);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--slots-per-entry") == 0 && i + 1 < argc) {
+            ctx.k = atoi(argv[++i]);
+            if (!IsValidRedundancy(ctx.k, C)) {
+                fprintf(stderr, "ERROR: Invalid number of slots per entry, from %d to %d\n", MIN_K, MAX_K);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--slot-ratio") == 0 && i + 1 < argc) {
+            ctx.c = atof(argv[++i]);
+            if (!IsValidRedundancy(K, ctx.c)) {
+                fprintf(stderr, "ERROR: Invalid slot ratio, from %.1f to %.1f\n", MIN_C, MAX_C);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--split-metadata") == 0) {
+            ctx.splitLayout = 1;
         } else {
-            fprintf(stderr, "Usage: %s [-o|--output] <output_path> [-l|--logs] <log_path> [-f|--filename <log_file_name>] [-m|--maxlogs <max_logs>]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [-o|--output] <output_path> [-l|--logs] <log_path> [-f|--filename <log_file_name>] [-m|--maxlogs <max_logs>] [-t|--threads <threads>] [-b|--background-init] [-s|--segment <entries>] [-p|--spares <spares>] [-d|--durability none|entry|batch|interval] [--batch-size <entries>] [--sync-interval <ms>] [-j|--journal] [-r|--resume] [--socket <socket_path>] [--shm <name>] [--shm-slots <slots>] [--pack] [--pack-timeout <ms>] [--message-len <bytes>] [--slots-per-entry <k>] [--slot-ratio <c>] [--split-metadata]\n", argv[0]);
             exit(EXIT_FAILURE);
         }
     }
 
-    if (ctx.outputPath == NULL || ctx.logPath == NULL) {
-        fprintf(stderr, "Both output and log paths must be specified\n");
+    if (ctx.outputPath == NULL || (ctx.logPath != NULL) + (ctx.socketPath != NULL) + (ctx.shmName != NULL) != 1) {
+        fprintf(stderr, "The output path and either a log path, a socket path or a shared memory name must be specified\n");
         exit(EXIT_FAILURE);
     }
-
-    return ctx;
-}
-
-char **readLogs(const char *path, int *logCount, int maxlogCount) {
-    FILE *file = fopen(path, "r");
     
-    if (!file) {
-        perror("ERROR: opening log file\n");
-        return NULL;
+    // the log file is sized before the first line is read.
+    if (ctx.maxLogs == INT_MAX && ctx.segmentSize == 0 && !ctx.resume) {
+        fprintf(stderr, "The maximum number of logs must be specified, unless segments are used\n");
+        exit(EXIT_FAILURE);
     }
     
-    int capacity = 1000; // Initial capacity for the array of line pointers
-    char **lines = malloc(capacity * sizeof(char *));
-    if (!lines) {
-        perror("ERROR: Memory allocation failed\n");
-        fclose(file);
-        return NULL;
+    if (ctx.journal && ctx.durability == DURABILITY_NONE) {
+        fprintf(stderr, "The journal requires a durability mode other than none\n");
+        exit(EXIT_FAILURE);
     }
     
-    char buffer[MAX_LINE_LENGTH];
-    int count = 0;
-    while (count < maxlogCount && fgets(buffer, MAX_LINE_LENGTH, file)) {
-        // Strip newline character if it exists
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') {
-            buffer[len - 1] = '\0';
-        }
-        
-        if (count >= capacity) {
-            // Increase the capacity
-            capacity *= 2;
-            char **newLines = realloc(lines, capacity * sizeof(char *));
-            if (!newLines) {
-                perror("ERROR: Memory reallocation failed\n");
-                for (int i = 0; i < count; ++i) {
-                    free(lines[i]);
-                }
-                free(lines);
-                fclose(file);
-                return NULL;
-            }
-            lines = newLines;
-        }
-
-        // Allocate space for the line and store it
-        lines[count] = strdup(buffer);
-        if (!lines[count]) {
-            perror("ERROR: Memory allocation failed\n");
-            for (int i = 0; i < count; ++i) {
-                free(lines[i]);
-            }
-            free(lines);
-            fclose(file);
-            return NULL;
-        }
-        count++;
+    if (ctx.resume && (ctx.segmentSize > 0 || ctx.backgroundInit)) {
+        fprintf(stderr, "A resumed log keeps its layout, the segment size and the background init can not be specified\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (ctx.spares > 0 && ctx.segmentSize == 0 && !ctx.resume) {
+        fprintf(stderr, "Spares are only used for segments, a segment size must be specified\n");
+        exit(EXIT_FAILURE);
     }
 
-    fclose(file);
-    *logCount = count;
-    return lines;
-
+    return ctx;
 }
@@ -103,6 +103,56 @@ int PRG(PRGContext *ctx, unsigned char *buffer, int size)
     return _PRG(ctx->seed, &ctx->counter, EVP_aes_256_ecb(), buffer, size);
 }
 
+int PRGSlots(unsigned char seed[KEY_SIZE], unsigned long firstSlot, unsigned long slotCount, int slotSize, unsigned char *buffer)
+{
+    EVP_CIPHER_CTX *ctx;
+    unsigned long blocksPerSlot = slotSize / AES_BLOCK_LEN;
+    size_t size = slotCount * slotSize;
+    size_t offset = 0;
+    int len;
+
+    if (slotSize % AES_BLOCK_LEN != 0)
+        return 0;
+
+    // Fill the counter blocks exactly like _PRG would do it, for a context which has been called once per slot:
+    // the 32 bit context counter wraps per slot, the counter inside of a single call does not.
+    memset(buffer, 0, size);
+    for (unsigned long s = 0; s < slotCount; ++s) {
+        unsigned int counter = (unsigned int)((firstSlot + s) * blocksPerSlot);
+        unsigned char *slot = buffer + s * slotSize;
+
+        for (unsigned long i = 0; i < blocksPerSlot; ++i) {
+            unsigned long ctr = i + counter;
+            memcpy(&slot[i * AES_BLOCK_LEN], &ctr, sizeof(unsigned long));
+        }
+    }
+
+    if (!(ctx = EVP_CIPHER_CTX_new()))
+        return 0;
+
+    if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_256_ecb(), NULL, seed, NULL)) {
+        EVP_CIPHER_CTX_free(ctx);
+        return 0;
+    }
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+    // encrypt the counter blocks in place, EVP_EncryptUpdate takes the length as int.
+    while (offset < size) {
+        size_t chunk = size - offset;
+        if (chunk > (INT_MAX / AES_BLOCK_LEN) * AES_BLOCK_LEN)
+            chunk = (INT_MAX / AES_BLOCK_LEN) * AES_BLOCK_LEN;
+
+        if (1 != EVP_EncryptUpdate(ctx, buffer + offset, &len, buffer + offset, (int)chunk) || len != (int)chunk) {
+            EVP_CIPHER_CTX_free(ctx);
+            return 0;
+        }
+        offset += chunk;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    return 1;
+}
+
 
 int AES_256_CTR_encrypt(unsigned char *plaintext, int plaintextSize, unsigned char *key, unsigned char *iv, unsigned char *ciphertextBuffer)
 {
@@ -365,16 +415,32 @@ int GenerateIV(unsigned char *iv)
 // TODO: set the max output size inside the cmac function? Fixed to 16.
 int CMAC(unsigned char *key, unsigned char *input, size_t inputSize, unsigned char *output, size_t *outputSize, size_t maxOutputSize/* Prevent buffer overflows, in the case that the maximal possible outbut buffer size is smaler than the actual output buffer. */)
 {
-    EVP_MAC *mac = EVP_MAC_fetch(NULL, "CMAC", NULL);
-    if (mac == NULL){
+    CMACContext ctx;
+    
+    if (CMACInit(&ctx, key) != 1) {
+        return 0;
+    }
+    if (CMACUpdate(&ctx, input, inputSize) != 1) {
+        CMACFree(&ctx);
+        return 0;
+    }
+    return CMACFinal(&ctx, output, outputSize, maxOutputSize);
+}
+
+int CMACInit(CMACContext *ctx, unsigned char *key)
+{
+    ctx->ctx = NULL;
+    ctx->mac = EVP_MAC_fetch(NULL, "CMAC", NULL);
+    if (ctx->mac == NULL){
         perror("Failed to fetch CMAC.");
         return 0;
     }
     
-    EVP_MAC_CTX *ctx = EVP_MAC_CTX_new(mac);
+    ctx->ctx = EVP_MAC_CTX_new(ctx->mac);
     
-    if (!ctx) {
+    if (!ctx->ctx) {
         perror("Failed to create MAC contxt.");
+        CMACFree(ctx);
         return 0;
     }
     
@@ -385,43 +451,53 @@ int CMAC(unsigned char *key, unsigned char *input, size_t inputSize, unsigned ch
     params[1] = OSSL_PARAM_construct_end();
     
     // braucht einen Array, nicht nur ein pointer auf einen Parameter.
-    if (EVP_MAC_CTX_set_params(ctx, params) != 1) {
+    if (EVP_MAC_CTX_set_params(ctx->ctx, params) != 1) {
         perror("Failed to set parameter.");
-        // free
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
+        CMACFree(ctx);
         return 0;
     }
     
-    if (EVP_MAC_init(ctx, key, KEY_SIZE, NULL) != 1) {
+    if (EVP_MAC_init(ctx->ctx, key, KEY_SIZE, NULL) != 1) {
         perror("Failed to init CMAC.");
-        // free
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
+        CMACFree(ctx);
         return 0;
     }
     
-    if (EVP_MAC_update(ctx, input, inputSize) != 1) {
+    return 1;
+}
+
+int CMACUpdate(CMACContext *ctx, const unsigned char *input, size_t inputSize)
+{
+    if (EVP_MAC_update(ctx->ctx, input, inputSize) != 1) {
         perror("Failed to update CMAC.");
-        // free
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
         return 0;
     }
-    
+    return 1;
+}
+
+int CMACFinal(CMACContext *ctx, unsigned char *output, size_t *outputSize, size_t maxOutputSize)
+{
     // If the maxOutputSize is to small, to hold the output -> the mission will be aborted.
-    if (EVP_MAC_final(ctx, output, outputSize, maxOutputSize) != 1) {
+    int success = EVP_MAC_final(ctx->ctx, output, outputSize, maxOutputSize);
+    
+    if (success != 1) {
         perror("Failed to create CMAC.");
-        // free
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
-        return 0;
     }
-    
-    // free
-    EVP_MAC_CTX_free(ctx);
-    EVP_MAC_free(mac);
-    return 1;
+    CMACFree(ctx);
+    return success == 1;
+}
+
+void CMACFree(CMACContext *ctx)
+{
+    EVP_MAC_CTX_free(ctx->ctx);
+    EVP_MAC_free(ctx->mac);
+    ctx->ctx = NULL;
+    ctx->mac = NULL;
+}
+
+int Digest(const unsigned char *input, size_t inputSize, unsigned char output[DIGEST_LEN])
+{
+    return EVP_Digest(input, inputSize, output, NULL, EVP_sha256(), NULL);
 }
 
 void handleErrors(void)
@@ -14,6 +14,7 @@
 #define AES_BLOCK_LEN 16
 #define KEY_SIZE 32
 #define IV_SIZE 16
+#define DIGEST_LEN 32
 
 // crypto constants with a large hamming distance
 // 4 constants of 1 byte, with a Hamming Distance of 4
@@ -65,6 +66,23 @@ int PRG(PRGContext *ctx, unsigned char *buffer, int size);
  */
 int PRG128(PRG128Context *ctx, unsigned char *buffer, int size);
 
+/*
+ * Function: PRGSlots
+ * ------------------
+ * Seekable bulk variant of PRG. Produces the same output as a fresh PRG context, which is called once per slot
+ * with slotSize bytes, but starts directly at the slot firstSlot (the counter of slot i is i * slotSize / AES_BLOCK_LEN).
+ * A single cipher context is used for the whole range, and the counter blocks are encrypted in place.
+ *
+ * seed: the seed of the PRG (e.g. the master key).
+ * firstSlot: index of the first slot to generate.
+ * slotCount: number of consecutive slots to generate.
+ * slotSize: size of a single slot, has to be a multiple of the AES block length.
+ * buffer: will hold the random data, of the size slotCount * slotSize.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int PRGSlots(unsigned char seed[KEY_SIZE], unsigned long firstSlot, unsigned long slotCount, int slotSize, unsigned char *buffer);
+
 // key stuff:
 
 /*
@@ -185,4 +203,36 @@ int AES_256_CTR_decrypt(unsigned char *ciphertext, int ciphertextSize, unsigned
  */
 int CMAC(unsigned char *key, unsigned char *input, size_t inputSize, unsigned char *output, size_t *outputSize, size_t maxOutputSize);
 
+// an incremental CMAC, over a message which is not in a single buffer.
+typedef struct CMACContext{
+    EVP_MAC *mac;
+    EVP_MAC_CTX *ctx;
+} CMACContext;
+
+/*
+ * Funtion: CMACInit, CMACUpdate, CMACFinal
+ * ----------------------------------------
+ * The same MAC as CMAC, with the message passed in parts to CMACUpdate. CMACFinal writes the MAC like CMAC, and
+ * releases the context. A context which is not finalized, has to be released with CMACFree.
+ *
+ * returns: 0 on failure and 1 on success. A failed CMACInit or CMACFinal leaves nothing to release.
+ */
+int CMACInit(CMACContext *ctx, unsigned char *key);
+int CMACUpdate(CMACContext *ctx, const unsigned char *input, size_t inputSize);
+int CMACFinal(CMACContext *ctx, unsigned char *output, size_t *outputSize, size_t maxOutputSize);
+void CMACFree(CMACContext *ctx);
+
+/*
+ * Funtion: Digest
+ * ---------------
+ * SHA-256 checksum, used to detect torn writes of the logger state (not a MAC).
+ *
+ * input: message.
+ * inputSize: message size.
+ * output: the digest, of the size DIGEST_LEN.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int Digest(const unsigned char *input, size_t inputSize, unsigned char output[DIGEST_LEN]);
+
 #endif /* Crypto_h */
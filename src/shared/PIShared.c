@@ -9,6 +9,7 @@
 #include "PIShared.h"
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "Crypto.h"
 
 int CreateID(unsigned char *key, int j, unsigned char IDlj[ID_LEN])
@@ -27,9 +28,9 @@ int CreateID(unsigned char *key, int j, unsigned char IDlj[ID_LEN])
     return 1;
 }
 
-int CreateIntegrityTag(unsigned char *key, unsigned char *XORlj, unsigned char Tlj[INTEGRITY_TAG_LEN])
+int CreateIntegrityTag(unsigned char *key, unsigned char *XORlj, size_t xorLen, unsigned char Tlj[INTEGRITY_TAG_LEN])
 {
-    if (0 == PRF(XORlj, CIPHERTEXT_LEN, key, Tlj, INTEGRITY_TAG_LEN)) {
+    if (0 == PRF(XORlj, xorLen, key, Tlj, INTEGRITY_TAG_LEN)) {
         perror("Error: Failed to create the integrity tag.\n");
         
         return 0;
@@ -38,6 +39,188 @@ int CreateIntegrityTag(unsigned char *key, unsigned char *XORlj, unsigned char T
     return 1;
 }
 
+int IsValidMessageLen(int messageLen)
+{
+    return messageLen >= MIN_MESSAGE_LEN && messageLen <= MAX_MESSAGE_LEN && (messageLen & (messageLen - 1)) == 0;
+}
+
+int IsValidRedundancy(int k, double c)
+{
+    return k >= MIN_K && k <= MAX_K && c >= MIN_C && c <= MAX_C;
+}
+
+void InitLogFileLayout(LogFileLayout *layout, int messageLen, int k, double c)
+{
+    layout->messageLen = messageLen;
+    layout->logLen = LOG_LEN_OF(messageLen);
+    layout->slotsOffset = LOG_HEADER_LEN;
+    layout->payloadOffset = 0;
+    layout->k = k;
+    layout->c = c;
+}
+
+void InitLegacyLogFileLayout(LogFileLayout *layout)
+{
+    layout->messageLen = MESSAGE_LEN;
+    layout->logLen = LOG_LEN;
+    layout->slotsOffset = 0;
+    layout->payloadOffset = 0;
+    layout->k = K;
+    layout->c = C;
+}
+
+unsigned long SlotCount(const LogFileLayout *layout, unsigned long n)
+{
+    return (unsigned long)ceil(n * layout->c);
+}
+
+void SplitLogFileLayout(LogFileLayout *layout, unsigned long m)
+{
+    uint64_t metaEnd = layout->slotsOffset + (uint64_t)m * SLOT_META_LEN;
+    
+    layout->payloadOffset = (metaEnd + LOG_PAGE_LEN - 1) / LOG_PAGE_LEN * LOG_PAGE_LEN;
+}
+
+uint64_t SlotOffset(const LogFileLayout *layout, unsigned long l)
+{
+    return layout->slotsOffset + (uint64_t)l * layout->logLen;
+}
+
+uint64_t PayloadOffset(const LogFileLayout *layout, unsigned long l)
+{
+    if (layout->payloadOffset == 0) {
+        return SlotOffset(layout, l);
+    }
+    return layout->payloadOffset + (uint64_t)l * (layout->logLen - SLOT_META_LEN);
+}
+
+uint64_t MetaOffset(const LogFileLayout *layout, unsigned long l)
+{
+    if (layout->payloadOffset == 0) {
+        return SlotOffset(layout, l) + layout->logLen - SLOT_META_LEN;
+    }
+    return layout->slotsOffset + (uint64_t)l * SLOT_META_LEN;
+}
+
+uint64_t LogFileSize(const LogFileLayout *layout, unsigned long m)
+{
+    return layout->payloadOffset == 0 ? SlotOffset(layout, m) : PayloadOffset(layout, m);
+}
+
+// helper function:
+// writes the value big endian.
+static void putUint(unsigned char *buffer, uint64_t value, int size)
+{
+    for (int i = size - 1; i >= 0; --i) {
+        buffer[i] = (unsigned char)value;
+        value >>= 8;
+    }
+}
+
+// helper function:
+// reads a big endian value.
+static uint64_t getUint(const unsigned char *buffer, int size)
+{
+    uint64_t value = 0;
+    
+    for (int i = 0; i < size; ++i) {
+        value = (value << 8) | buffer[i];
+    }
+    return value;
+}
+
+// magic(8) version(4) message len(4) n(8) m(8) K(4) C in millionths(4) flags(4) MAC(16), version 1 has no flags.
+#define HEADER_FLAGS_OFFSET 40
+#define HEADER_MAC_OFFSET 44
+#define HEADER_V1_MAC_OFFSET 40
+
+int EncodeLogFileHeader(const LogFileLayout *layout, unsigned long n, unsigned long m, unsigned char *masterKey, unsigned char header[LOG_HEADER_LEN])
+{
+    size_t macLen;
+    
+    memset(header, 0, LOG_HEADER_LEN);
+    memcpy(header, LOG_HEADER_MAGIC, 8);
+    putUint(header + 8, LOG_HEADER_VERSION, 4);
+    putUint(header + 12, layout->messageLen, 4);
+    putUint(header + 16, n, 8);
+    putUint(header + 24, m, 8);
+    putUint(header + 32, layout->k, 4);
+    putUint(header + 36, (uint64_t)(layout->c * 1000000 + 0.5), 4);
+    putUint(header + HEADER_FLAGS_OFFSET, layout->payloadOffset != 0 ? LOG_LAYOUT_SPLIT : 0, 4);
+    
+    if (0 == CMAC(masterKey, header, HEADER_MAC_OFFSET, header + HEADER_MAC_OFFSET, &macLen, MAC_LEN) || macLen != MAC_LEN) {
+        perror("Error: Failed to create the MAC of the log file header.\n");
+        return 0;
+    }
+    
+    return 1;
+}
+
+int DecodeLogFileHeader(const unsigned char header[LOG_HEADER_LEN], unsigned char *masterKey, LogFileLayout *layout, unsigned long *n, unsigned long *m)
+{
+    unsigned char mac[MAC_LEN];
+    size_t macLen;
+    
+    if (memcmp(header, LOG_HEADER_MAGIC, 8) != 0) {
+        return 0;
+    }
+    
+    uint64_t version = getUint(header + 8, 4);
+    int macOffset = version == 1 ? HEADER_V1_MAC_OFFSET : HEADER_MAC_OFFSET;
+    if (masterKey != NULL
+        && (0 == CMAC(masterKey, (unsigned char *)header, macOffset, mac, &macLen, MAC_LEN) || macLen != MAC_LEN
+            || memcmp(mac, header + macOffset, MAC_LEN) != 0)) {
+        fprintf(stderr, "Error: The MAC of the log file header does not match.\n");
+        return -1;
+    }
+    
+    int messageLen = (int)getUint(header + 12, 4);
+    int k = (int)getUint(header + 32, 4);
+    double c = getUint(header + 36, 4) / 1000000.0;
+    uint64_t flags = version == 1 ? 0 : getUint(header + HEADER_FLAGS_OFFSET, 4);
+    if ((version != 1 && version != LOG_HEADER_VERSION) || (flags & ~(uint64_t)LOG_LAYOUT_SPLIT) != 0
+        || !IsValidMessageLen(messageLen) || !IsValidRedundancy(k, c)) {
+        fprintf(stderr, "Error: The log file header is not supported.\n");
+        return -1;
+    }
+    
+    InitLogFileLayout(layout, messageLen, k, c);
+    *n = (unsigned long)getUint(header + 16, 8);
+    *m = (unsigned long)getUint(header + 24, 8);
+    if (flags & LOG_LAYOUT_SPLIT) {
+        SplitLogFileLayout(layout, *m);
+    }
+    return 1;
+}
+
+int UnpackMessage(const unsigned char *message, size_t messageLen, const unsigned char *records[PACK_MAX_RECORDS], size_t lengths[PACK_MAX_RECORDS])
+{
+    size_t offset = PACK_HEADER_LEN;
+    int count = message[3];
+    
+    if (message[0] != 0x00 || message[1] != 'P' || message[2] != 'K' || count == 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        if (offset + PACK_RECORD_HEADER_LEN > messageLen) {
+            return -1;
+        }
+        
+        size_t length = ((size_t)message[offset] << 8) | message[offset + 1];
+        offset += PACK_RECORD_HEADER_LEN;
+        
+        if (offset + length > messageLen) {
+            return -1;
+        }
+        records[i] = message + offset;
+        lengths[i] = length;
+        offset += length;
+    }
+    
+    return count;
+}
+
 void printInHex(unsigned char *out, int len)
 {
     for (int i = 0; i < len; ++i) {
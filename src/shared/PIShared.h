@@ -9,16 +9,52 @@
 #ifndef PIShared_h
 #define PIShared_h
 
-#define MESSAGE_LEN 1024 // The max len of an log entry message.
+#include <stddef.h>
+#include <stdint.h>
+
+#define MESSAGE_LEN 1024 // The default len of an log entry message, and the len of a log file without a header.
+#define MIN_MESSAGE_LEN 128 // The message len is chosen per log file, a power of two between MIN and MAX.
+#define MAX_MESSAGE_LEN 4096
 #define INTEGRITY_TAG_LEN 16 // The integrity tag len.
 #define ID_LEN 16 // The ID (to find the correct key for this log entry) len.
 #define MAC_LEN 16 // Encrypt then MAC HMAC len. ??CMAC??
-#define CIPHERTEXT_LEN (IV_SIZE + MESSAGE_LEN + MAC_LEN)
-#define LOG_LEN (CIPHERTEXT_LEN + INTEGRITY_TAG_LEN + ID_LEN)
+#define CIPHERTEXT_LEN_OF(messageLen) (IV_SIZE + (messageLen) + MAC_LEN)
+#define LOG_LEN_OF(messageLen) (CIPHERTEXT_LEN_OF(messageLen) + INTEGRITY_TAG_LEN + ID_LEN)
+#define CIPHERTEXT_LEN CIPHERTEXT_LEN_OF(MESSAGE_LEN)
+#define LOG_LEN LOG_LEN_OF(MESSAGE_LEN)
+#define MAX_CIPHERTEXT_LEN CIPHERTEXT_LEN_OF(MAX_MESSAGE_LEN)
+#define MAX_LOG_LEN LOG_LEN_OF(MAX_MESSAGE_LEN)
+#define LOG_HEADER_LEN 4096 // The header takes the first page of a log file, the slots start page aligned behind it.
+#define LOG_HEADER_MAGIC "PILOGHDR"
+#define LOG_HEADER_VERSION 2 // version 1 has no layout flags.
+#define LOG_LAYOUT_SPLIT 0x1 // layout flag: the tags and IDs of all slots are stored apart from the payloads.
+#define LOG_PAGE_LEN 4096 // the payload region of the split layout starts page aligned.
+#define SLOT_META_LEN (INTEGRITY_TAG_LEN + ID_LEN) // the tag and ID of a slot, the XOR part is its payload.
 #define LOG_EXTENSION ".log.enc"
 #define KEY_EXTENSION ".key"
-#define K 5
-#define C 1.1244
+#define MASTER_KEY_EXTENSION ".masterKey" KEY_EXTENSION // master key of a segment, appended to the segment name.
+#define MANIFEST_EXTENSION ".manifest" // ordered list of all segments, one line "<log file> <master key file> <n>" per segment.
+#define PACK_HEADER_LEN 4 // header of a packed message: 0x00 'P' 'K' <number of records>.
+#define PACK_RECORD_HEADER_LEN 2 // every record of a packed message starts with its length (big endian).
+#define PACK_MAX_RECORDS 255
+#define K 5 // default number of slots per entry, a log file records its own (LogFileLayout).
+#define C 1.1244 // default ratio of slots to entries, m = ceil(n * C).
+#define MIN_K 3 // with two slots an entry is lost on every cycle of the slot graph.
+#define MAX_K 8
+#define MIN_C 1.0
+#define MAX_C 4.0
+
+/*
+ the geometry of a log file, read from its header.
+ */
+typedef struct {
+    int messageLen; // (l) length of a message, the ciphertext and the slots grow with it.
+    size_t logLen; // length of a slot: ciphertext, integrity tag and ID.
+    uint64_t slotsOffset; // offset of the first slot (of the first tag in the split layout), 0 for a log file without a header.
+    uint64_t payloadOffset; // split layout: offset of the payload region, 0 if the slots are interleaved.
+    int k; // (K) number of slots every entry is written to.
+    double c; // (C) ratio of slots to entries.
+} LogFileLayout;
 
 /*
  * Function: CreateID
@@ -31,8 +67,121 @@ int CreateID(unsigned char *key, int j, unsigned char IDlj[ID_LEN]);
  * Function: CreateIntegrityTag
  * ----------------------------
  * T_{l_j} = PRF_{K_i} (XOR_{l_j})
+ *
+ * xorLen: length of XOR_{l_j}, the ciphertext length of the log file.
+ */
+int CreateIntegrityTag(unsigned char *key, unsigned char *XORlj, size_t xorLen, unsigned char Tlj[INTEGRITY_TAG_LEN]);
+
+/*
+ * Function: IsValidMessageLen
+ * ---------------------------
+ * returns: 1 if the message len is a power of two between MIN_MESSAGE_LEN and MAX_MESSAGE_LEN, 0 otherwise.
+ */
+int IsValidMessageLen(int messageLen);
+
+/*
+ * Function: IsValidRedundancy
+ * ---------------------------
+ * returns: 1 if k is between MIN_K and MAX_K and c between MIN_C and MAX_C, 0 otherwise.
+ */
+int IsValidRedundancy(int k, double c);
+
+/*
+ * Function: InitLogFileLayout
+ * ---------------------------
+ * Initializes the layout of a log file with a header, the given message len, k and c.
+ * A log file without a header (written before the header existed) has the layout of InitLegacyLogFileLayout.
+ */
+void InitLogFileLayout(LogFileLayout *layout, int messageLen, int k, double c);
+void InitLegacyLogFileLayout(LogFileLayout *layout);
+
+/*
+ * Function: SlotCount
+ * -------------------
+ * returns: m = ceil(n * c), the number of slots of a log file for n entries.
+ */
+unsigned long SlotCount(const LogFileLayout *layout, unsigned long n);
+
+/*
+ * Function: SplitLogFileLayout
+ * ----------------------------
+ * Changes the layout to the split layout for m slots: behind the header, a dense region holds the tag and ID of every
+ * slot (SLOT_META_LEN bytes each), followed by the page aligned region of the XOR parts (the payloads). A slot is still
+ * handled as XOR | T | ID in memory, and its pad is the same.
+ */
+void SplitLogFileLayout(LogFileLayout *layout, unsigned long m);
+
+/*
+ * Function: SlotOffset
+ * --------------------
+ * returns: the file offset of the slot l, only for the interleaved layout.
+ */
+uint64_t SlotOffset(const LogFileLayout *layout, unsigned long l);
+
+/*
+ * Function: PayloadOffset
+ * -----------------------
+ * returns: the file offset of the XOR part of the slot l, in both layouts.
+ */
+uint64_t PayloadOffset(const LogFileLayout *layout, unsigned long l);
+
+/*
+ * Function: MetaOffset
+ * --------------------
+ * returns: the file offset of the tag and ID of the slot l, in both layouts.
+ */
+uint64_t MetaOffset(const LogFileLayout *layout, unsigned long l);
+
+/*
+ * Function: LogFileSize
+ * ---------------------
+ * returns: the size of a log file of m slots, including the header.
+ */
+uint64_t LogFileSize(const LogFileLayout *layout, unsigned long m);
+
+/*
+ * Function: EncodeLogFileHeader
+ * -----------------------------
+ * Writes the header of a log file: magic, version, message len, n, m, K, C and the layout flags (big endian), authenticated by a CMAC
+ * with the master key (k0) of the log file.
+ *
+ * header: will hold the header, LOG_HEADER_LEN bytes.
+ *
+ * returns: 0 on failure and 1 on success.
+ */
+int EncodeLogFileHeader(const LogFileLayout *layout, unsigned long n, unsigned long m, unsigned char *masterKey, unsigned char header[LOG_HEADER_LEN]);
+
+/*
+ * Function: DecodeLogFileHeader
+ * -----------------------------
+ * Reads the header of a log file.
+ *
+ * header: the first LOG_HEADER_LEN bytes of the log file.
+ * masterKey: the master key (k0) of the log file, to check the MAC. NULL skips the check.
+ * layout: will hold the layout of the log file.
+ * n: will hold the max number of entries.
+ * m: will hold the number of slots.
+ *
+ * returns: 1 on success, 0 if the file has no header (it has the legacy layout), -1 if the header is invalid, its MAC
+ * does not match or it is not supported.
+ */
+int DecodeLogFileHeader(const unsigned char header[LOG_HEADER_LEN], unsigned char *masterKey, LogFileLayout *layout, unsigned long *n, unsigned long *m);
+
+/*
+ * Function: UnpackMessage
+ * -----------------------
+ * Splits a packed message (many short log messages in a single entry) into its records. A plain message never starts
+ * with the packed header, as it would start with a 0 byte, which ends a plain message. The logger writes such a message
+ * as an empty entry.
+ *
+ * message: the decrypted message.
+ * messageLen: the message len of the log file.
+ * records: will point to the start of every record (at most PACK_MAX_RECORDS).
+ * lengths: will hold the length of every record.
+ *
+ * returns: the number of records, -1 if the message is not packed or malformed.
  */
-int CreateIntegrityTag(unsigned char *key, unsigned char *XORlj, unsigned char Tlj[INTEGRITY_TAG_LEN]);
+int UnpackMessage(const unsigned char *message, size_t messageLen, const unsigned char *records[PACK_MAX_RECORDS], size_t lengths[PACK_MAX_RECORDS]);
 
 // utility functions
 void printInHex(unsigned char *out, int len);
@@ -0,0 +1,264 @@
+//
+//  KeyCache.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "KeyCache.hpp"
+#include <iostream>
+#include <filesystem>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace PI;
+
+// magic(8) version(4) n(8) m(8) K(4) chunk len(4) record len(4) IV(16) MAC(16), zero padded.
+#define KEY_CACHE_IV_OFFSET 40
+#define KEY_CACHE_MAC_OFFSET 56
+
+static const char cacheLabel[] = "PI key cache";
+
+// helper function:
+// writes the value big endian.
+static void putUint(unsigned char *buffer, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; --i) {
+        buffer[i] = (unsigned char)value;
+        value >>= 8;
+    }
+}
+
+KeyCache::~KeyCache() {
+    unmap();
+    if (!tempPath.empty()) {
+        // an incomplete cache is never moved in place.
+        unlink(tempPath.c_str());
+    }
+}
+
+std::string KeyCache::PathOf(const std::string &directory, const std::string &logFilePath) {
+    return (std::filesystem::path(directory) / std::filesystem::path(logFilePath).filename()).string() + KEY_CACHE_EXTENSION;
+}
+
+bool KeyCache::Open(const std::string &path, const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen, ThreadPool &pool) {
+    struct stat st;
+
+    this->path = path;
+    if (!init(masterKey, n, m, k, chunkLen, recordLen)) {
+        return false;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size != size) {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping holds its own reference to the file.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    data = static_cast<unsigned char*>(mapping);
+
+    // the header has to describe the same schedule, and be authentic along with the tags.
+    unsigned char header[KEY_CACHE_HEADER_LEN];
+    unsigned char mac[MAC_LEN];
+    encodeHeader(header);
+    std::copy_n(data + KEY_CACHE_IV_OFFSET, IV_SIZE, iv.begin());
+    std::copy_n(iv.begin(), IV_SIZE, header + KEY_CACHE_IV_OFFSET);
+    headerMAC(mac);
+    if (0 != memcmp(header, data, KEY_CACHE_MAC_OFFSET) || 0 != memcmp(mac, data + KEY_CACHE_MAC_OFFSET, MAC_LEN)) {
+        unmap();
+        return false;
+    }
+
+    // check the tags of all chunks, every chunk is read once.
+    int chunks = (n + chunkLen - 1) / chunkLen;
+    std::atomic<bool> authentic {true};
+    madvise(data, size, MADV_SEQUENTIAL);
+    {
+        TaskGroup checks(pool);
+        for (int chunk = 0; chunk < chunks; ++chunk) {
+            checks.Run([this, chunk, &authentic]() {
+                unsigned char tag[MAC_LEN];
+                chunkTag(chunk, tag);
+                if (0 != memcmp(tag, data + KEY_CACHE_HEADER_LEN + (size_t)chunk * MAC_LEN, MAC_LEN)) {
+                    authentic = false;
+                }
+            });
+        }
+        checks.Wait();
+    }
+    if (!authentic) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+bool KeyCache::Create(const std::string &path, const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen) {
+    this->path = path;
+    if (!init(masterKey, n, m, k, chunkLen, recordLen) || 1 != GenerateIV(iv.data())) {
+        return false;
+    }
+
+    std::string temp = path + ".tmp";
+    int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) {
+        perror("Could not create the key cache");
+        return false;
+    }
+    tempPath = temp;
+    if (ftruncate(fd, (off_t)size) == -1) {
+        perror("Could not size the key cache");
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    data = static_cast<unsigned char*>(mapping);
+    return true;
+}
+
+void KeyCache::Read(int chunk, void *records) const {
+    size_t len = (size_t)chunkRecords(chunk) * recordLen;
+    std::array<unsigned char, IV_SIZE> counter = counterAt(chunk);
+
+    // the C function only reads its inputs.
+    if ((int)len != AES_256_CTR_decrypt(data + chunkOffset(chunk), (int)len, const_cast<unsigned char*>(encKey.data()), counter.data(), static_cast<unsigned char*>(records))) {
+        std::cerr << "ERROR: Decrypting the key cache failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void KeyCache::Write(int chunk, const void *records) {
+    size_t len = (size_t)chunkRecords(chunk) * recordLen;
+    std::array<unsigned char, IV_SIZE> counter = counterAt(chunk);
+
+    // the C function only reads its inputs.
+    if ((int)len != AES_256_CTR_encrypt(static_cast<unsigned char*>(const_cast<void*>(records)), (int)len, encKey.data(), counter.data(), data + chunkOffset(chunk))) {
+        std::cerr << "ERROR: Encrypting the key cache failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    chunkTag(chunk, data + KEY_CACHE_HEADER_LEN + (size_t)chunk * MAC_LEN);
+}
+
+bool KeyCache::Close() {
+    encodeHeader(data);
+    std::copy(iv.begin(), iv.end(), data + KEY_CACHE_IV_OFFSET);
+    headerMAC(data + KEY_CACHE_MAC_OFFSET);
+
+    if (msync(data, size, MS_SYNC) == -1) {
+        perror("Could not write the key cache");
+        return false;
+    }
+    unmap();
+    if (rename(tempPath.c_str(), path.c_str()) == -1) {
+        perror("Could not move the key cache in place");
+        return false;
+    }
+    tempPath.clear();
+    return true;
+}
+
+bool KeyCache::init(const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen) {
+    unsigned char keys[2 * KEY_SIZE];
+    unsigned char label[sizeof(cacheLabel)];
+
+    this->n = n;
+    this->m = m;
+    this->k = k;
+    this->chunkLen = chunkLen;
+    this->recordLen = recordLen;
+    size = chunkOffset(0) + (size_t)n * recordLen;
+
+    // the keys of the cache are independent of the key chain of the log file.
+    std::copy_n(cacheLabel, sizeof(cacheLabel), label);
+    if (0 == PRF(label, sizeof(cacheLabel), const_cast<unsigned char*>(masterKey.data()), keys, sizeof(keys))) {
+        std::cerr << "Error: Failed to derive the keys of the key cache." << std::endl;
+        return false;
+    }
+    std::copy_n(keys, KEY_SIZE, encKey.begin());
+    std::copy_n(keys + KEY_SIZE, KEY_SIZE, macKey.begin());
+    return true;
+}
+
+void KeyCache::encodeHeader(unsigned char *header) const {
+    memset(header, 0, KEY_CACHE_MAC_OFFSET);
+    memcpy(header, KEY_CACHE_MAGIC, 8);
+    putUint(header + 8, KEY_CACHE_VERSION, 4);
+    putUint(header + 12, n, 8);
+    putUint(header + 20, m, 8);
+    putUint(header + 28, k, 4);
+    putUint(header + 32, chunkLen, 4);
+    putUint(header + 36, recordLen, 4);
+}
+
+void KeyCache::headerMAC(unsigned char *mac) const {
+    int chunks = (n + chunkLen - 1) / chunkLen;
+    std::vector<unsigned char> input(KEY_CACHE_MAC_OFFSET + (size_t)chunks * MAC_LEN);
+    size_t macLen;
+
+    // the header up to the MAC, with the IV, and the tags of all chunks in order.
+    encodeHeader(input.data());
+    std::copy(iv.begin(), iv.end(), input.data() + KEY_CACHE_IV_OFFSET);
+    std::copy_n(data + KEY_CACHE_HEADER_LEN, (size_t)chunks * MAC_LEN, input.data() + KEY_CACHE_MAC_OFFSET);
+
+    if (0 == CMAC(const_cast<unsigned char*>(macKey.data()), input.data(), input.size(), mac, &macLen, MAC_LEN) || macLen != MAC_LEN) {
+        std::cerr << "ERROR: Creating the MAC of the key cache failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void KeyCache::chunkTag(int chunk, unsigned char *tag) const {
+    size_t macLen;
+
+    if (0 == CMAC(const_cast<unsigned char*>(macKey.data()), data + chunkOffset(chunk), (size_t)chunkRecords(chunk) * recordLen, tag, &macLen, MAC_LEN) || macLen != MAC_LEN) {
+        std::cerr << "ERROR: Creating the tag of the key cache failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+size_t KeyCache::chunkOffset(int chunk) const {
+    int chunks = (n + chunkLen - 1) / chunkLen;
+    return KEY_CACHE_HEADER_LEN + (size_t)chunks * MAC_LEN + (size_t)chunk * chunkLen * recordLen;
+}
+
+int KeyCache::chunkRecords(int chunk) const {
+    return std::min(chunkLen, n - chunk * chunkLen);
+}
+
+std::array<unsigned char, IV_SIZE> KeyCache::counterAt(int chunk) const {
+    std::array<unsigned char, IV_SIZE> counter = iv;
+    // the records are a multiple of the AES block.
+    uint64_t blocks = (uint64_t)chunk * chunkLen * recordLen / AES_BLOCK_LEN;
+
+    // add to the big endian 128 bit counter.
+    for (int i = IV_SIZE - 1; i >= 0 && blocks != 0; --i) {
+        uint64_t sum = counter[i] + (blocks & 0xff);
+        counter[i] = (unsigned char)sum;
+        blocks = (blocks >> 8) + (sum >> 8);
+    }
+    return counter;
+}
+
+void KeyCache::unmap() {
+    if (data != nullptr) {
+        munmap(data, size);
+        data = nullptr;
+    }
+}
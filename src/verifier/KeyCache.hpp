@@ -0,0 +1,120 @@
+//
+//  KeyCache.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef KeyCache_hpp
+#define KeyCache_hpp
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include "PITypes.hpp"
+#include "ThreadPool.hpp"
+
+#define KEY_CACHE_MAGIC "PIKCACHE"
+#define KEY_CACHE_VERSION 1
+#define KEY_CACHE_EXTENSION ".keycache"
+#define KEY_CACHE_HEADER_LEN 80 // followed by a tag per chunk, and the records.
+
+namespace PI {
+    /*
+     the key schedule of an entry, as stored in the key cache: its chain key, its locations and the IDs of its k slots.
+     The size is a multiple of the AES block, the padding is 0.
+     */
+    template<int Kn>
+    struct alignas(16) KeyCacheRecord {
+        KEY_TYPE key;
+        std::array<int, Kn> drn;
+        std::array<ID_TYPE, Kn> IDs;
+    };
+
+    /*
+     an on-disk cache of the key schedule of a log file, so that a repeated verification skips the key evolution, the
+     locations and the IDs. The schedule only depends on the master key, n, m and k, the cache records them.
+     The records are encrypted (AES-256-CTR) and every chunk of them is tagged (CMAC), under two keys derived from the
+     master key. The header and the tags are authenticated as a whole, so chunks can not be swapped.
+     A cache is created under a temporary name, and moved in place once it is complete.
+     */
+    class KeyCache {
+    public:
+        KeyCache() = default;
+        ~KeyCache();
+        KeyCache(const KeyCache&) = delete;
+        KeyCache& operator=(const KeyCache&) = delete;
+
+        // returns: the path of the cache of the log file at logFilePath, within the directory.
+        static std::string PathOf(const std::string &directory, const std::string &logFilePath);
+
+        /*
+         * Function: Open
+         * --------------
+         * maps the cache at path, and authenticates its header and, on the pool, every chunk.
+         * returns: false if there is no cache, it belongs to a different schedule, or it has been modified.
+         */
+        bool Open(const std::string &path, const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen, ThreadPool &pool);
+
+        /*
+         * Function: Create
+         * ----------------
+         * creates an empty cache for the schedule, to be filled with Write.
+         * returns: false if it can not be created, the verification continues without it.
+         */
+        bool Create(const std::string &path, const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen);
+
+        /*
+         * Function: Read, Write
+         * ---------------------
+         * decrypts the records of the chunk into records, or encrypts and tags them into the cache. Chunks are read
+         * and written independently of each other, from any thread.
+         */
+        void Read(int chunk, void *records) const;
+        void Write(int chunk, const void *records);
+
+        /*
+         * Function: Close
+         * ---------------
+         * authenticates the header of a created cache, syncs it and moves it in place. Prints and returns false on a
+         * failure.
+         */
+        bool Close();
+
+    private:
+        std::string path;
+        std::string tempPath; // the name of a created cache, until it is closed.
+        unsigned char *data = nullptr; // the mapping.
+        size_t size = 0;
+        int n = 0, m = 0, k = 0, chunkLen = 0;
+        size_t recordLen = 0;
+        KEY_TYPE encKey {};
+        KEY_TYPE macKey {};
+        std::array<unsigned char, IV_SIZE> iv {};
+
+        // helper function:
+        // derives the encryption and the MAC key of the cache from the master key, and sizes it.
+        bool init(const KEY_TYPE &masterKey, int n, int m, int k, int chunkLen, size_t recordLen);
+        // helper function:
+        // encodes the header up to its MAC.
+        void encodeHeader(unsigned char *header) const;
+        // helper function:
+        // the MAC of the header and the tags of all chunks.
+        void headerMAC(unsigned char *mac) const;
+        // helper function:
+        // the tag of the chunk, over its ciphertext.
+        void chunkTag(int chunk, unsigned char *tag) const;
+        // helper function:
+        // the offset of the first record of the chunk, and the number of its records.
+        size_t chunkOffset(int chunk) const;
+        int chunkRecords(int chunk) const;
+        // helper function:
+        // the counter block of the record stream at the offset of the chunk.
+        std::array<unsigned char, IV_SIZE> counterAt(int chunk) const;
+        void unmap();
+    };
+}
+
+#endif /* KeyCache_hpp */
@@ -0,0 +1,66 @@
+//
+//  KeySchedule.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "KeySchedule.hpp"
+#include <iostream>
+
+using namespace PI;
+
+KeySchedule::KeySchedule(const KEY_TYPE &k0, int n, int interval)
+    : k0(k0), n(n), interval(interval), kept(n / interval) {
+}
+
+void KeySchedule::Evolve(int first, int last) {
+    KEY_TYPE key = first == 0 ? k0 : kept[first / interval - 1];
+
+    // line 2
+    for (int i = first; i < last; ++i) {
+        evolve(key);
+        if ((i + 1) % interval == 0) {
+            kept[i / interval] = key;
+        }
+    }
+}
+
+void KeySchedule::Walk(int first, int last, const std::function<void(int i, const KEY_TYPE &key)> &visit) const {
+    if (interval == 1) {
+        for (int i = first; i < last; ++i) {
+            visit(i, kept[i]);
+        }
+        return;
+    }
+
+    // evolve from the last key of the block before first.
+    int block = first / interval;
+    KEY_TYPE key = block == 0 ? k0 : kept[block - 1];
+
+    for (int i = block * interval; i < last; ++i) {
+        evolve(key);
+        if (i >= first) {
+            visit(i, key);
+        }
+    }
+}
+
+void KeySchedule::Derive(const KEY_TYPE &key, Keys &ks) {
+    ks.Key = key;
+
+    // DeriveSubKeys only reads the session key.
+    if (0 == DeriveSubKeys(const_cast<unsigned char*>(key.data()), ks.EncKey.data(), ks.DrnKey.data(), ks.TagKey.data(), ks.IDKey.data()))
+    {
+        std::cerr << "Error: Failed to derive sub keys." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void KeySchedule::evolve(KEY_TYPE &key) {
+    if (0 == KeyEvolution(key.data(), key.data())){
+        std::cerr << "ERROR: Key Evolution failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
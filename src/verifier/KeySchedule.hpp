@@ -0,0 +1,83 @@
+//
+//  KeySchedule.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef KeySchedule_hpp
+#define KeySchedule_hpp
+
+#include <vector>
+#include <functional>
+#include "PITypes.hpp"
+
+#define KEY_INTERVAL_MAX 1024 // the largest interval of kept keys, has to divide KEY_CHUNK.
+
+namespace PI {
+    /*
+     the key chain of a log file, in a flat array of the chain keys only. Every interval-th key is kept, the keys between
+     them are evolved again from the closest kept one, and the sub keys are derived again by every pass that needs them.
+     With the interval 1 every key is kept, 32 bytes per entry, a larger interval trades memory for key evolutions.
+     */
+    class KeySchedule {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * the chain of n keys from k0. interval is a power of two up to KEY_INTERVAL_MAX.
+         */
+        KeySchedule(const KEY_TYPE &k0, int n, int interval);
+
+        /*
+         * Function: Evolve
+         * ----------------
+         * evolves the keys of the entries [first, last), and keeps every interval-th of them. first is a multiple of
+         * KEY_INTERVAL_MAX, the keys before it have been evolved. Exits if the key evolution fails.
+         */
+        void Evolve(int first, int last);
+
+        /*
+         * Function: Keep
+         * --------------
+         * keeps the key of the entry i, if it is one of the kept keys. Instead of Evolve, for keys which are known
+         * already (see KeyCache).
+         */
+        void Keep(int i, const KEY_TYPE &key) {
+            if ((i + 1) % interval == 0) {
+                kept[i / interval] = key;
+            }
+        }
+
+        /*
+         * Function: Walk
+         * --------------
+         * calls visit with the key of every entry of [first, last) in order, evolved from the closest kept key before
+         * first. The keys before last have to be evolved.
+         */
+        void Walk(int first, int last, const std::function<void(int i, const KEY_TYPE &key)> &visit) const;
+
+        /*
+         * Function: Derive
+         * ----------------
+         * derives the sub keys of the key into ks. Exits if the derivation fails.
+         */
+        static void Derive(const KEY_TYPE &key, Keys &ks);
+
+        // returns: the bytes kept for n entries with the interval.
+        static size_t Memory(int n, int interval) { return (size_t)(n / interval) * KEY_SIZE; }
+
+    private:
+        KEY_TYPE k0;
+        int n;
+        int interval;
+        std::vector<KEY_TYPE> kept; // kept[j] is the key of the entry (j + 1) * interval - 1, the last of its block.
+
+        // helper function:
+        // evolves the key once in place.
+        static void evolve(KEY_TYPE &key);
+    };
+}
+
+#endif /* KeySchedule_hpp */
@@ -0,0 +1,108 @@
+//
+//  LogFileView.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "LogFileView.hpp"
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace PI;
+
+LogFileView::LogFileView(const std::string &path) {
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        std::cerr << "Could not open file log file." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        std::cerr << "Error: The log file is empty." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping holds its own reference to the file.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    data = static_cast<unsigned char*>(mapping);
+}
+
+LogFileView::~LogFileView() {
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+}
+
+bool LogFileView::Bind(const LogFileLayout &layout, unsigned long m) {
+    if (LogFileSize(&layout, m) > size) {
+        return false;
+    }
+
+    this->layout = layout;
+    this->m = m;
+    nulled.clear();
+    zeroXOR.assign(layout.logLen - SLOT_META_LEN, 0);
+    return true;
+}
+
+const unsigned char *LogFileView::XOR(unsigned long l) const {
+    if (!nulled.empty() && nulled.count(l) != 0) {
+        return zeroXOR.data();
+    }
+    return data + PayloadOffset(&layout, l);
+}
+
+void LogFileView::NullXOR(unsigned long l) {
+    nulled.insert(l);
+}
+
+bool LogFileView::IsNullXOR(unsigned long l) const {
+    const unsigned char *x = XOR(l);
+    return std::all_of(x, x + zeroXOR.size(), [](unsigned char b) { return b == 0; });
+}
+
+void LogFileView::AdviseMeta() const {
+    if (layout.payloadOffset != 0) {
+        // the tags and IDs are a single dense region, read ahead all of it.
+        advise(MetaOffset(&layout, 0), (uint64_t)m * SLOT_META_LEN, MADV_WILLNEED);
+        advise(MetaOffset(&layout, 0), (uint64_t)m * SLOT_META_LEN, MADV_SEQUENTIAL);
+    } else {
+        // interleaved, every page of the slots is touched.
+        advise(layout.slotsOffset, (uint64_t)m * layout.logLen, MADV_SEQUENTIAL);
+    }
+}
+
+void LogFileView::AdvisePayloads(bool sequential) const {
+    uint64_t offset = PayloadOffset(&layout, 0);
+    uint64_t len = LogFileSize(&layout, m) - offset;
+
+    advise(offset, len, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+void LogFileView::advise(uint64_t offset, uint64_t len, int advice) const {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = offset - offset % page;
+    uint64_t end = std::min<uint64_t>(offset + len, size);
+
+    if (end <= start) {
+        return;
+    }
+    // only a hint, a failure is not an error.
+    madvise(data + start, end - start, advice);
+}
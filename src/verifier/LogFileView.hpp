@@ -0,0 +1,87 @@
+//
+//  LogFileView.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef LogFileView_hpp
+#define LogFileView_hpp
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include "PITypes.hpp"
+
+namespace PI {
+    /*
+     read-only view of a log file, mapped into memory. The slots are read in place, nothing of the log file is copied.
+     A slot whose XOR part is nulled (because it has been tampered) is held in a small overlay, the mapping itself
+     stays read-only.
+     */
+    class LogFileView {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * maps the log file at path. Exits if the file can not be opened or mapped.
+         */
+        LogFileView(const std::string &path);
+        ~LogFileView();
+        LogFileView(const LogFileView&) = delete;
+        LogFileView& operator=(const LogFileView&) = delete;
+
+        /*
+         * Function: Bind
+         * --------------
+         * locates the m slots of the view by the layout. Returns false if the file is too short for them.
+         */
+        bool Bind(const LogFileLayout &layout, unsigned long m);
+
+        const unsigned char *Data() const { return data; }
+        size_t Size() const { return size; }
+
+        /*
+         * Function: XOR, Tag, ID
+         * ----------------------
+         * returns: the parts of the slot l, pointing into the mapping, or into the overlay for a nulled XOR part.
+         */
+        const unsigned char *XOR(unsigned long l) const;
+        const unsigned char *Tag(unsigned long l) const { return data + MetaOffset(&layout, l); }
+        const unsigned char *ID(unsigned long l) const { return data + MetaOffset(&layout, l) + INTEGRITY_TAG_LEN; }
+
+        /*
+         * Function: NullXOR
+         * -----------------
+         * nulls the XOR part of the slot l, in the overlay.
+         */
+        void NullXOR(unsigned long l);
+        // returns: true if the XOR part of the slot l has been nulled, or is null within the log file.
+        bool IsNullXOR(unsigned long l) const;
+
+        /*
+         * Function: AdviseMeta, AdvisePayloads
+         * ------------------------------------
+         * hints the access pattern of the next pass to the OS: the tags and IDs of all slots are read in order,
+         * the XOR parts are read either at random (the tag checks), or once in order (removing the pad).
+         */
+        void AdviseMeta() const;
+        void AdvisePayloads(bool sequential) const;
+
+    private:
+        unsigned char *data = nullptr; // the mapping.
+        size_t size = 0; // length of the file and the mapping.
+        LogFileLayout layout {};
+        unsigned long m = 0;
+        std::unordered_set<unsigned long> nulled; // the overlay: slots whose XOR part has been nulled.
+        std::vector<unsigned char> zeroXOR; // the XOR part of every nulled slot.
+
+        // helper function:
+        // advises the page aligned range around [offset, offset + len).
+        void advise(uint64_t offset, uint64_t len, int advice) const;
+    };
+}
+
+#endif /* LogFileView_hpp */
@@ -125,7 +125,7 @@ namespace Matrix {
         }
         
     private:
-        bool freeableData;
+        bool freeableData = true;
     };
     
     
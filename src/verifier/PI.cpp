@@ -12,19 +12,34 @@
 #include <iostream>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <array>
 #include <iterator>
 #include <cstring>
 #include <chrono>
+#include <cmath>
+#include <mutex>
+#include <unistd.h>
+#include <atomic>
 
 #include "gaussian-elimination/GaussianElimination.hpp"
 #include "gaussian-elimination/PlainGaussHelper.hpp"
 
 #include "Matrix.hpp"
+#include "LogFileView.hpp"
+#include "ResultWriter.hpp"
+#include "TaskGraph.hpp"
+#include "PayloadArena.hpp"
+#include "KeySchedule.hpp"
+#include "KeyCache.hpp"
+#include "SolvePlan.hpp"
 
 using namespace Gauss;
 using namespace PI;
+
+// the chain is evolved in chunks, every chunk has to start at a kept key.
+static_assert(KEY_CHUNK % KEY_INTERVAL_MAX == 0, "KEY_INTERVAL_MAX has to divide KEY_CHUNK");
 using namespace std;
 using namespace Matrix;
 
@@ -33,302 +48,766 @@ using std::chrono::duration;
 
 namespace fs = std::filesystem;
 
-Verifier::Verifier(VerifierContext *ctx): ctx(ctx) {
+// helper function:
+// dst = a ^ b, 16 bytes at a time (SSE2 or NEON, whichever the target has).
+static void xorBytes(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len) {
+    typedef unsigned char Block __attribute__((vector_size(16)));
+    size_t i = 0;
+    
+    for (; i + sizeof(Block) <= len; i += sizeof(Block)) {
+        Block x, y;
+        memcpy(&x, a + i, sizeof(Block));
+        memcpy(&y, b + i, sizeof(Block));
+        x ^= y;
+        memcpy(dst + i, &x, sizeof(Block));
+    }
+    for (; i < len; ++i) {
+        dst[i] = a[i] ^ b[i];
+    }
 }
 
-Result Verifier::Verify() {
-    Result res;
-    std::vector<std::string> logFiles = getAllLogFiles(ctx->logFileDirectory, LOG_EXTENSION);
+Verifier::Verifier(VerifierContext *ctx): ctx(ctx), pool(ctx->threads) {
+}
 
-    for (const auto &logFile : logFiles) {
-        cout << "Start verifying: " << logFile << endl;
-        Verifier::verifySingleLogFile(logFile, ctx->outFile);
+// helper function:
+// the memory budget in bytes, half of the physical memory by default.
+static size_t memoryBudget(const VerifierContext *ctx) {
+    if (ctx->memoryBudget != 0) {
+        return ctx->memoryBudget;
     }
+    return (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE) / 2;
+}
+
+// helper function:
+// the estimated peak memory in bytes of verifying a log file, with rank = n. The mapped log file is not counted.
+// planMemory is the solve plan, which is recorded or executed (see SolvePlan::Memory).
+static size_t estimateMemory(const LogFileLayout &layout, int n, int m, int keyInterval, bool metal, size_t planMemory) {
+    size_t cipherLen = layout.logLen - SLOT_META_LEN;
+    size_t bucketsM = (n + B_B_BITS - 1) / B_B_BITS, bucketsI = (m + B_B_BITS - 1) / B_B_BITS;
+    size_t memory = (size_t)m * bucketsM * sizeof(B256) // M.
+        + (size_t)m * cipherLen // the arena of v, which becomes c.
+        + KeySchedule::Memory(n, keyInterval) // the kept chain keys.
+        + (size_t)n * (layout.k * sizeof(int) + layout.messageLen) // locations and the output.
+        + (size_t)m * 64 // the IDs of the log file.
+        + planMemory;
     
-    return res;
+    if (metal) {
+        // the identity matrix of the bookkeeping, and its result.
+        memory += (size_t)m * bucketsI * sizeof(B256) + (size_t)m * cipherLen;
+    }
+    return memory;
 }
 
-// here is where the magic happens.
-Result Verifier::verifySingleLogFile(std::string path, std::string resultPath) {
+// helper function:
+// the estimated relative runtime of verifying a log file, dominated by the forward reduction.
+static double estimateCost(const LogFileLayout &layout, int n, int m) {
+    return (double)m * ((n + B_B_BITS - 1) / B_B_BITS) * n + (double)m * layout.logLen + (double)n * layout.k * layout.logLen;
+}
+
+Result Verifier::Verify() {
     Result res {1, true};
-    std::unordered_map<ID_TYPE, KeyStoreEntry> KeyStore;
-    vector<Keys> keys;
-    std::vector<Tau_i> Tau(ctx->m);
-    std::unordered_map<int, array<int, K>> drns;
-    KEY_TYPE Ki, encKey, drnKey, tagKey, idKey, k0;
-    const XOR_TYPE nullVector = {0};
-    
-    std::ifstream logFile(path, std::ios::binary); // this is our log file :*
-    int rank = 0; // line 10
-    BMatrixType *M;
+    std::vector<std::string> manifests = getAllLogFiles(ctx->logFileDirectory, MANIFEST_EXTENSION);
+    std::vector<Segment> segments;
     
-    if (!logFile.is_open()) {
-        std::cerr << "Could not open file log file." << std::endl;
-        exit(EXIT_FAILURE);
+    if (manifests.empty()) {
+        // a single log file, with the provided master key.
+        for (const auto &logFile : getAllLogFiles(ctx->logFileDirectory, LOG_EXTENSION)) {
+            segments.push_back({logFile, ctx->masterKeyPath, ctx->n});
+        }
+    } else {
+        // the key option names the directory of the segment keys, or one of the keys within it.
+        fs::path keyDirectory = ctx->masterKeyPath;
+        if (!fs::is_directory(keyDirectory)) {
+            keyDirectory = keyDirectory.parent_path();
+        }
+        
+        std::sort(manifests.begin(), manifests.end());
+        for (const auto &manifest : manifests) {
+            auto listed = readManifest(manifest, keyDirectory.string());
+            segments.insert(segments.end(), listed.begin(), listed.end());
+        }
     }
     
-    k0 = readMasterKey(ctx->masterKeyPath);
-    Ki = k0;
+    if (segments.size() == 1) {
+        cout << "Start verifying: " << segments[0].logFilePath << endl;
+        return Verifier::verifySingleLogFile(segments[0].logFilePath, ctx->outFile, segments[0].masterKeyPath, segments[0].n);
+    }
     
-    // generate all possible n keys
-    // line 1
-    for (int i = 1; i <= ctx->n; ++i) {
-        std::array<int, K> kRandom;
-        // generate the ith keye.
-        // line 2
-        if (0 == KeyEvolution(Ki.data(), Ki.data())){
-            std::cerr << "ERROR: Key Evolution failed." << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        // derive all sub keys, and store them.
-        if (0 == DeriveSubKeys(Ki.data(), encKey.data(), drnKey.data(), tagKey.data(), idKey.data()))
+    // the segments are independent of each other, as many of them are verified at once as fit into the memory
+    // budget, the longest ones first. Every one writes into its own part of the result, which are appended to the
+    // result in order, as soon as all earlier ones are done.
+    size_t budget = memoryBudget(ctx);
+    
+    std::vector<SegmentPlan> plans;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        plans.push_back(planSegment(segments[i], i));
+    }
+    std::vector<size_t> pending(plans.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+        pending[i] = i;
+    }
+    std::stable_sort(pending.begin(), pending.end(), [&](size_t a, size_t b) { return plans[a].cost > plans[b].cost; });
+    
+    std::vector<Result> results(plans.size());
+    std::vector<double> seconds(plans.size());
+    std::vector<std::atomic<bool>> done(plans.size());
+    std::mutex mutex; // guards memory and running.
+    size_t memory = 0, merged = 0;
+    int running = 0;
+    TaskGroup files(pool);
+    
+    while (merged < plans.size()) {
+        std::vector<size_t> starts;
         {
-            std::cerr << "Error: Failed to derive sub keys." << std::endl;
-            exit(EXIT_FAILURE);
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = pending.begin(); it != pending.end() && running < pool.Size();) {
+                // a log file larger than the budget is verified alone.
+                if (running > 0 && memory + plans[*it].memory > budget) {
+                    ++it;
+                    continue;
+                }
+                memory += plans[*it].memory;
+                running++;
+                starts.push_back(*it);
+                it = pending.erase(it);
+            }
         }
-        Keys ks = {Ki, encKey, drnKey, tagKey, idKey};
         
-        keys.push_back(ks);
+        for (size_t i : starts) {
+            if (plans[i].memory > budget) {
+                cout << "WARNING: " << plans[i].segment.logFilePath << " needs about " << (plans[i].memory >> 20) << " MiB, more than the memory budget." << endl;
+            }
+            
+            files.Run([&, i]() {
+                auto t1 = high_resolution_clock::now();
+                
+                cout << "Start verifying: " << plans[i].segment.logFilePath << endl;
+                // the part is appended to, a part left over by an interrupted run must not end up in the result.
+                fs::remove(partPath(i));
+                results[i] = Verifier::verifySingleLogFile(plans[i].segment.logFilePath, partPath(i), plans[i].segment.masterKeyPath, plans[i].segment.n);
+                seconds[i] = duration<double>(high_resolution_clock::now() - t1).count();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    memory -= plans[i].memory;
+                    running--;
+                }
+                done[i] = true;
+                pool.Notify();
+            });
+        }
         
-        // re generate the k distinct random locations.
-        // line 3
-        if (0 == DRN(drnKey.data(), K, ctx->m, kRandom.data())){
-            std::cerr << "Error: Failed to create k distinct random numbers." << std::endl;
-            exit(EXIT_FAILURE);
+        // wait until the next part can be appended, or another log file can be started. The scheduler does not
+        // verify a log file itself, unless the pool has no worker.
+        pool.WaitUntil([&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return done[merged] || (running < pool.Size() && std::any_of(pending.begin(), pending.end(), [&](size_t i) {
+                return running == 0 || memory + plans[i].memory <= budget;
+            }));
+        }, false);
+        while (merged < plans.size() && done[merged]) {
+            appendPart(partPath(merged), ctx->outFile);
+            merged++;
         }
-        // store them.
-        drns[(i-1)] = kRandom;
+    }
+    files.Wait();
+    
+    // report every log file, in the logging order.
+    cout << "Verified " << plans.size() << " log files:" << endl;
+    for (size_t i = 0; i < plans.size(); ++i) {
+        cout << "  " << plans[i].segment.logFilePath << ": " << results[i].entries << " entries, " << results[i].tamperedSlots << " tampered slots, "
+             << (results[i].success ? "ok" : "TAMPERED") << ", ~" << (plans[i].memory >> 20) << " MiB, " << seconds[i] << " s" << endl;
         
-        // regenerate all key IDs for each of the k locations.
-        // line 4
-        for (int j = 0; j < K; ++j) {
-            array<unsigned char, ID_LEN> ID;
-            int lj = kRandom[j];
-            
-            // generate the ID.
-            // line 5
-            if (0 == CreateID(idKey.data(), j, ID.data())) {
-                std::cerr << "Error: Failed to createID." << std::endl;
-                exit(EXIT_FAILURE);
-            }
-            // store the k IDs with the associated key, log iteration index, and the respective location within the log file.
-            // line 5
-            KeyStoreEntry newEntry = {ks, i, lj};
-            
-            KeyStore[ID] = newEntry;
+        if (!results[i].success) {
+            res = results[i];
         }
     }
     
-    // Predict M's rank:
-    std::array<unsigned char, LOG_LEN>log;//(ID_LEN);
-    int j;
-    // line 11
-    for (int i = 0; i < ctx->m; ++i) {
-        // get the entry Tau_i from the log file.
-        logFile.seekg(i * LOG_LEN, std::ios::beg);
-        logFile.read(reinterpret_cast<char*>(log.data()), LOG_LEN);
-        if (!logFile) {
-            std::cerr << "Error: reading from log file. Consider choosing right amount for N." << std::endl;
+    return res;
+}
+
+SegmentPlan Verifier::planSegment(const Segment &segment, size_t index) {
+    SegmentPlan plan {segment, index};
+    LogFileView logFile(segment.logFilePath);
+    KEY_TYPE k0 = readMasterKey(segment.masterKeyPath);
+    
+    plan.n = segment.n;
+    readLogFileLayout(logFile, k0, plan.layout, plan.n, plan.m);
+    size_t planMemory = ctx->solvePlan.empty() ? 0 : SolvePlan::Memory(plan.n, plan.m, memoryBudget(ctx));
+    plan.memory = estimateMemory(plan.layout, plan.n, plan.m, ctx->keyInterval, ctx->useMetal, planMemory);
+    plan.cost = estimateCost(plan.layout, plan.n, plan.m);
+    return plan;
+}
+
+std::string Verifier::partPath(size_t index) {
+    return ctx->outFile + "." + std::to_string(index) + ".part";
+}
+
+void Verifier::appendPart(const std::string &partPath, const std::string &resultPath) {
+    std::ifstream part(partPath, std::ios::binary);
+    std::ofstream result(resultPath, std::ios::app | std::ios::binary);
+    
+    if (!result.is_open()) {
+        std::cerr << "ERROR: opening the result file!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // a log file without any entry leaves no part.
+    if (part.is_open() && !(result << part.rdbuf())) {
+        // an empty part sets the failbit as well.
+        if (part.peek() != std::ifstream::traits_type::eof()) {
+            std::cerr << "ERROR: writing the result file!" << std::endl;
             exit(EXIT_FAILURE);
         }
-        // parse the entry Tau_i
-        Tau_i taui;
-        
-        std::copy(log.begin(), log.begin() + CIPHERTEXT_LEN, taui.XOR.begin());
-        std::copy(log.begin() + CIPHERTEXT_LEN, log.begin() + CIPHERTEXT_LEN + INTEGRITY_TAG_LEN, taui.T.begin());
-        std::copy(log.begin() + CIPHERTEXT_LEN + INTEGRITY_TAG_LEN, log.begin() + CIPHERTEXT_LEN + INTEGRITY_TAG_LEN + ID_LEN, taui.ID.begin());
-        
-        Tau[i] = taui;
-        
-        // check if the ID can be found in the KeyStore, and if it is found, check wether it is the current highest number.
-        // line 12
-        auto it = KeyStore.find(taui.ID);
-        if (KeyStore.end() == it) {
-            continue; // NEXT
-        }
+    }
+    part.close();
+    fs::remove(partPath);
+}
+
+std::vector<Segment> Verifier::readManifest(const std::string& manifestPath, const std::string& keyDirectory) {
+    std::vector<Segment> segments;
+    std::ifstream manifest(manifestPath);
+    std::string logFileName, masterKeyName;
+    int n;
+    
+    if (!manifest.is_open()) {
+        std::cerr << "ERROR: Could not open the manifest: " << manifestPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
+    // one line per segment: <log file> <master key file> <n>
+    while (manifest >> logFileName >> masterKeyName >> n) {
+        fs::path logFilePath = fs::path(manifestPath).parent_path() / logFileName;
+        fs::path masterKeyPath = fs::path(keyDirectory) / masterKeyName;
         
-        j = it->second.i;
-        // line 13
-        rank = max(rank, j);
+        segments.push_back({logFilePath.string(), masterKeyPath.string(), n});
     }
     
-    // check if rank is larger 0
-    // line 15
-    if (rank == 0) {
-        cerr << "ERROR: Rank is 0." << endl;
+    if (!manifest.eof()) {
+        std::cerr << "ERROR: Malformed manifest: " << manifestPath << std::endl;
         exit(EXIT_FAILURE);
     }
     
-    cout << "Detected " << rank << " different log entries." << endl;
+    return segments;
+}
+
+void Verifier::readLogFileLayout(const LogFileView &logFile, KEY_TYPE &k0, LogFileLayout &layout, int &n, int &m) {
+    unsigned long headerN, headerM;
+    
+    // the header records the layout, n and m. A log file without a header has the legacy layout.
+    int decoded = logFile.Size() >= LOG_HEADER_LEN ? DecodeLogFileHeader(logFile.Data(), k0.data(), &layout, &headerN, &headerM) : 0;
     
-    // Create M=m x n zero Matrix over GF(2).
-    // line 9
-    M = new BMatrixType(ctx->m, rank);
-	
-    // null all vectors in the log file, which have been tampered, to avoid them corrupting the output.
-    // line 16
-    for (int i = 0; i < rank; ++i) {
-        // line 18
-        for (int j = 0; j < K; ++j) {
-            // get the k distinct random locations, for the ith log iteration.
-            // line 17
+    if (decoded == -1) {
+        std::cerr << "ERROR: The header of the log file has been tampered or is not supported." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
+    if (decoded == 1) {
+        n = (int)headerN;
+        m = (int)headerM;
+    } else {
+        InitLegacyLogFileLayout(&layout);
+        m = (int)SlotCount(&layout, n);
+    }
+}
+
+Result Verifier::verifySingleLogFile(std::string path, std::string resultPath, std::string masterKeyPath, int n) {
+    LogFileView logFile(path); // this is our log file :*
+    LogFileLayout layout;
+    int m, headerN = n;
+    
+    KEY_TYPE k0 = readMasterKey(masterKeyPath);
+    
+    readLogFileLayout(logFile, k0, layout, headerN, m);
+    if (headerN != n) {
+        cout << "The log file holds up to " << headerN << " entries, as recorded in its header." << endl;
+        n = headerN;
+    }
+    
+    if (!logFile.Bind(layout, m)) {
+        std::cerr << "Error: reading from log file. Consider choosing right amount for N." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
+    std::string cachePath = ctx->keyCache.empty() ? "" : KeyCache::PathOf(ctx->keyCache, path);
+    std::string planPath = ctx->solvePlan.empty() ? "" : SolvePlan::PathOf(ctx->solvePlan, path);
+    
+    // the verifier is instantiated for every message len and k.
+    switch (layout.messageLen) {
+#define VERIFY_MESSAGE_LEN(L) case L: return verifyLogFileWithK<L>(logFile, resultPath, cachePath, planPath, k0, layout, n, m);
+        FOR_EACH_MESSAGE_LEN(VERIFY_MESSAGE_LEN)
+#undef VERIFY_MESSAGE_LEN
+        default:
+            std::cerr << "ERROR: Unsupported message len " << layout.messageLen << "." << std::endl;
+            exit(EXIT_FAILURE);
+    }
+}
+
+template<int L>
+Result Verifier::verifyLogFileWithK(LogFileView &logFile, std::string resultPath, std::string cachePath, std::string planPath, KEY_TYPE k0, const LogFileLayout &layout, int n, int m) {
+    switch (layout.k) {
+#define VERIFY_K(Kn) case Kn: return verifyLogFile<L, Kn>(logFile, resultPath, cachePath, planPath, k0, layout, n, m);
+        FOR_EACH_K(VERIFY_K)
+#undef VERIFY_K
+        default:
+            std::cerr << "ERROR: Unsupported number of slots per entry " << layout.k << "." << std::endl;
+            exit(EXIT_FAILURE);
+    }
+}
+
+// here is where the magic happens.
+// The verification is a graph of tasks, which overlap as far as their dependencies allow: the key chain, the scan of
+// the IDs and the removal of the pad start at once. The keys are checked against the log file in chunks, as soon as
+// a chunk of the chain is ready. Once all checks are done, M is built and solved, and the entries are decrypted
+// while the back substitution still finalizes the earlier ones. With a solve plan of the same M, the plan is executed
+// instead, and M is never built.
+template<int L, int Kn>
+Result Verifier::verifyLogFile(LogFileView &logFile, std::string resultPath, std::string cachePath, std::string planPath, KEY_TYPE k0, const LogFileLayout &layout, int n, int m) {
+    Result res {1, true};
+    constexpr size_t cipherLen = CIPHERTEXT_LEN_OF(L);
+    KeySchedule keys(k0, n, ctx->keyInterval); // the chain keys, the sub keys are derived again by every pass.
+    std::vector<array<int, Kn>> drns(n); // the locations of every entry, a flat n x K table.
+    std::vector<char> present(n, 0); // an ID of the entry is found in the log file.
+    std::unordered_set<ID_TYPE> fileIDs; // the IDs of all slots.
+    std::vector<std::atomic<uint64_t>> valid((m + 63) / 64); // slots whose tag has been checked by their entry.
+    PayloadArena<L> v(m); // the payloads, from the pad removal to the decryption.
+    std::vector<std::string> parts;
+    
+    int rank = 0; // line 10
+    BMatrixType *M = nullptr;
+    SolvePlan plan(k0, SolvePlan::MaxSteps(memoryBudget(ctx)));
+    bool planned = false, recording = false;
+    
+    TaskGraph graph(pool);
+    TaskGroup decrypts(pool);
+    
+    // Collect the IDs of all slots, to predict M's rank. In the split layout they are a single dense region.
+    TaskGraph::Node scan = graph.Add([&]() {
+        logFile.AdviseMeta();
+        fileIDs.reserve(m);
+        // line 11
+        for (int i = 0; i < m; ++i) {
+            ID_TYPE ID;
+            std::copy_n(logFile.ID(i), ID_LEN, ID.begin());
+            fileIDs.insert(ID);
+        }
+    });
+    
+    // the key schedule of a previous verification, or a new cache of it.
+    KeyCache cache;
+    bool cached = false, caching = false;
+    if (!cachePath.empty()) {
+        cached = cache.Open(cachePath, k0, n, m, Kn, KEY_CHUNK, sizeof(KeyCacheRecord<Kn>), pool);
+        if (cached) {
+            cout << "Using the key cache " << cachePath << "." << endl;
+        } else {
+            if (std::filesystem::exists(cachePath)) {
+                cout << "The key cache " << cachePath << " does not match the log file, it is replaced." << endl;
+            }
+            caching = cache.Create(cachePath, k0, n, m, Kn, KEY_CHUNK, sizeof(KeyCacheRecord<Kn>));
+        }
+    }
+    
+    // the plan of a previous solve, it is bound to M once M's shape is known.
+    TaskGraph::Node load = 0;
+    if (!planPath.empty()) {
+        load = graph.Add([&]() {
+            if (!plan.Load(planPath) && std::filesystem::exists(planPath)) {
+                cout << "The solve plan " << planPath << " has been modified or exceeds the memory budget, it is replaced." << endl;
+            }
+        });
+    }
+    
+    // check the slots of the entry i against its sub keys and the IDs of its k locations.
+    auto check = [&](int i, const Keys &ks, const array<ID_TYPE, Kn> &IDs) {
+        for (int j = 0; j < Kn; ++j) {
+            const ID_TYPE &ID = IDs[j];
             int lj = drns[i][j];
+            
+            // check if the ID can be found in the log file, the highest such entry is the rank.
+            // line 12
+            if (fileIDs.count(ID) != 0) {
+                present[i] = 1;
+            }
+            
+            // the slot lj is owned by this entry, if it holds its ID. Whether it has been tampered only
+            // depends on the owner, so every slot is checked once.
             // line 18
-            KeyStoreEntry kse = KeyStore[Tau[lj].ID];
+            if (0 != memcmp(ID.data(), logFile.ID(lj), ID_LEN)) {
+                continue;
+            }
             TAG_TYPE _T;
             
-            // create the integrity tag based on the XOR part
+            // create the integrity tag based on the XOR part, CreateIntegrityTag only reads it.
             // line 20
-            if (0 == CreateIntegrityTag(kse.Ki.TagKey.data(), Tau[lj].XOR.data(), _T.data())) {
+            if (0 == CreateIntegrityTag(const_cast<unsigned char*>(ks.TagKey.data()), const_cast<unsigned char*>(logFile.XOR(lj)), cipherLen, _T.data())) {
                 cerr << "ERROR: Failed to create the integrity tag." << endl;
                 exit(EXIT_FAILURE);
             }
-            // check wether the vector has been tampered
-            // line 20
-            if (kse.lj == lj && _T == Tau[lj].T) {
-                // toggle the bit in M
-                // line 20
-                M->setBit(lj, i);// data[lj * M->buckets + i] = 1;
-                continue;
-            }
-            // check if it has been nulled already, because the locations could be check severall times.
-            if (Tau[lj].XOR != nullVector) {
-                cout << "Line '" << lj << "' has been tampered." << endl;
+            if (0 == memcmp(_T.data(), logFile.Tag(lj), INTEGRITY_TAG_LEN)) {
+                valid[lj / 64].fetch_or(1ull << (lj % 64), std::memory_order_relaxed);
             }
-            
-            // null the tampered vector.
-            // line 21
-            std::fill(Tau[lj].XOR.begin(), Tau[lj].XOR.end(), 0);
-            // set basic tampering indicator
-            res.success = false;
-            res.code = 0;
         }
+    };
+    
+    // generate all possible n keys, the chain is sequential, a chunk at a time. With a key cache, the chain, the
+    // locations and the IDs are read from it instead.
+    // line 1
+    std::vector<TaskGraph::Node> checks;
+    TaskGraph::Node previous = 0;
+    for (int first = 0; first < n; first += KEY_CHUNK) {
+        int last = min(first + KEY_CHUNK, n);
+        int chunk = first / KEY_CHUNK;
+        
+        if (cached) {
+            checks.push_back(graph.Add([&, first, last, chunk]() {
+                std::vector<KeyCacheRecord<Kn>> records(last - first);
+                cache.Read(chunk, records.data());
+                
+                for (int i = first; i < last; ++i) {
+                    const KeyCacheRecord<Kn> &record = records[i - first];
+                    Keys ks;
+                    
+                    keys.Keep(i, record.key);
+                    KeySchedule::Derive(record.key, ks);
+                    drns[i] = record.drn;
+                    check(i, ks, record.IDs);
+                }
+            }, {scan}));
+            continue;
+        }
+        
+        std::vector<TaskGraph::Node> after;
+        if (first > 0) {
+            after.push_back(previous);
+        }
+        
+        previous = graph.Add([&, first, last]() {
+            // generate the keys of the chunk.
+            // line 2
+            keys.Evolve(first, last);
+        }, after);
+        
+        // derive the sub keys, locations and IDs of the chunk, and check the tags of the slots its entries own.
+        checks.push_back(graph.Add([&, first, last, chunk]() {
+            std::vector<KeyCacheRecord<Kn>> records(caching ? last - first : 0);
+            
+            keys.Walk(first, last, [&](int i, const KEY_TYPE &key) {
+                Keys ks;
+                array<ID_TYPE, Kn> IDs;
+                
+                // derive all sub keys, they are only needed during the check.
+                KeySchedule::Derive(key, ks);
+                
+                // re generate the k distinct random locations.
+                // line 3
+                if (0 == DRN(ks.DrnKey.data(), Kn, m, drns[i].data())){
+                    std::cerr << "Error: Failed to create k distinct random numbers." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                
+                // regenerate all key IDs for each of the k locations.
+                // line 4
+                for (int j = 0; j < Kn; ++j) {
+                    // generate the ID.
+                    // line 5
+                    if (0 == CreateID(ks.IDKey.data(), j, IDs[j].data())) {
+                        std::cerr << "Error: Failed to createID." << std::endl;
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                check(i, ks, IDs);
+                
+                if (caching) {
+                    KeyCacheRecord<Kn> &record = records[i - first];
+                    record.key = key;
+                    record.drn = drns[i];
+                    record.IDs = IDs;
+                }
+            });
+            
+            if (caching) {
+                cache.Write(chunk, records.data());
+            }
+        }, {previous, scan}));
     }
     
+    // the cache is complete once all chunks are checked.
+    if (caching) {
+        graph.Add([&]() {
+            if (cache.Close()) {
+                cout << "Wrote the key cache " << cachePath << "." << endl;
+            }
+        }, checks);
+    }
     
-    // Remove the random PAD.
+    // Remove the random PAD, straight from the log file into the arena v, the only copy of the XOR parts.
+    // The pad of the slot i starts at a known counter of the PRG (see PRGSlots), so the slots are split into ranges,
+    // and every range generates its pad in bulk. Tampered slots are nulled in v afterwards.
     // line 23
-    PRGContext *prgCtx = CreatePRGContext(k0.data());
-    std::array<unsigned char, LOG_LEN> randomPad;
-    
+    std::vector<TaskGraph::Node> pads;
+    logFile.AdvisePayloads(true);
     // line 24
-    for (int i = 0; i < ctx->m; ++i) {
-        // line 25
-        if (-1 == PRG(prgCtx, randomPad.data(), LOG_LEN)) {
-            delete prgCtx;
-            cerr << "ERROR: Creating random PAD." << endl;
+    for (int first = 0; first < m; first += PAD_REMOVAL_GRAIN) {
+        int last = min(first + PAD_REMOVAL_GRAIN, m);
+        
+        pads.push_back(graph.Add([&, first, last]() {
+            std::vector<unsigned char> randomPad((size_t)(last - first) * LOG_LEN_OF(L));
+            
+            // line 25
+            if (1 != PRGSlots(k0.data(), first, last - first, LOG_LEN_OF(L), randomPad.data())) {
+                cerr << "ERROR: Creating random PAD." << endl;
+                exit(EXIT_FAILURE);
+            }
+            
+            for (int i = first; i < last; ++i) {
+                // Check if the XOR part is null within the log file.
+                // line 25
+                if (logFile.IsNullXOR(i))
+                    continue;
+                
+                // remove random pad of the XOR part of Tau[i].
+                // line 25
+                xorBytes(v[i].data(), logFile.XOR(i), randomPad.data() + (size_t)(i - first) * LOG_LEN_OF(L), cipherLen);
+            }
+        }));
+    }
+    
+    // build M from the checks, in the order of the entries.
+    std::vector<TaskGraph::Node> checked = checks;
+    checked.insert(checked.end(), pads.begin(), pads.end());
+    if (!planPath.empty()) {
+        checked.push_back(load);
+    }
+    TaskGraph::Node apply = graph.Add([&]() {
+        // line 13
+        for (int i = 0; i < n; ++i) {
+            if (present[i]) {
+                rank = i + 1;
+            }
+        }
+        
+        // check if rank is larger 0
+        // line 15
+        if (rank == 0) {
+            cerr << "ERROR: Rank is 0." << endl;
             exit(EXIT_FAILURE);
         }
-        // It is important to generate the PRG output first, and abort the iteration after, otherwise the internal state (counter) differs from the original state.
         
-        // Check if the XOR part has been nulled.
-        // line 25
-        if (Tau[i].XOR == nullVector)
-            continue;
+        cout << "Detected " << rank << " different log entries." << endl;
+        res.entries = rank;
         
-        // remove random pad of the XOR part of Tau[i].
-        // line 25
-        std::transform(Tau[i].XOR.begin(), Tau[i].XOR.end(), randomPad.begin(), Tau[i].XOR.begin(), [](unsigned char a, unsigned char b){
-            return a ^ b;
-        });
-    }
-    
-    delete prgCtx;
-    
-    std::vector<XOR_TYPE> v;
-    v.reserve(Tau.size());
-
-    // Use std::transform to extract XOR elements into a new vector
-    std::transform(Tau.begin(), Tau.end(), std::back_inserter(v),
-        [](const Tau_i& tau) { return tau.XOR; });
-    
-    std::vector<PI::XOR_TYPE> c;
-    // choose metal or CPU:
-    if (ctx->useMetal) {
-        auto t1 = high_resolution_clock::now();
-        GaussianElimination ge (M, v);
-        // solve gauss, and get the cipher text vector c
-        // line 27
-        c = ge.solve();
-        auto t2 = high_resolution_clock::now();
+        // the slots owned by every entry, -1 for the others. They are the 1s of M.
+        std::vector<int> owned((size_t)rank * Kn, -1);
         
-        duration<long, std::nano> ns_double = t2 - t1;
+        // null all vectors in the log file, which have been tampered, to avoid them corrupting the output.
+        // line 16
+        for (int i = 0; i < rank; ++i) {
+            // line 18
+            for (int j = 0; j < Kn; ++j) {
+                // get the k distinct random locations, for the ith log iteration.
+                // line 17
+                int lj = drns[i][j];
+                
+                if (valid[lj / 64].load(std::memory_order_relaxed) >> (lj % 64) & 1) {
+                    owned[(size_t)i * Kn + j] = lj;
+                    continue;
+                }
+                // check if it has been nulled already, because the locations could be check severall times.
+                if (!logFile.IsNullXOR(lj)) {
+                    cout << "Line '" << lj << "' has been tampered." << endl;
+                    res.tamperedSlots++;
+                }
+                
+                // null the tampered vector, in the overlay of the read-only log file, and in v.
+                // line 21
+                logFile.NullXOR(lj);
+                std::fill(v[lj].begin(), v[lj].end(), 0);
+                // set basic tampering indicator
+                res.success = false;
+                res.code = 0;
+            }
+        }
         
-        cout << "Gaussian Elimination (Metal): " << ns_double.count() << " ns." << endl;
-    } else {
-        auto t1 = high_resolution_clock::now();
-        // solve gauss, and get the cipher text vector c
-        // line 27
-        c = PlainGaussHelper::Solve(M, v, false);
-        auto t2 = high_resolution_clock::now();
+        if (!planPath.empty()) {
+            planned = plan.Bind(m, rank, Kn, owned);
+            if (planned) {
+                cout << "Using the solve plan " << planPath << " (" << plan.Steps() << " steps)." << endl;
+                return;
+            }
+            // a tampered log file has a different M, its solve is not recorded. Only the CPU solver records.
+            recording = res.success && !ctx->useMetal;
+        }
         
-        duration<long, std::nano> ns_double = t2 - t1;
+        // Create M=m x n zero Matrix over GF(2).
+        // line 9
+        M = new BMatrixType(m, rank);
+        for (int i = 0; i < rank; ++i) {
+            for (int j = 0; j < Kn; ++j) {
+                int lj = owned[(size_t)i * Kn + j];
+                
+                if (lj >= 0) {
+                    // toggle the bit in M
+                    // line 20
+                    M->setBit(lj, i);// data[lj * M->buckets + i] = 1;
+                }
+            }
+        }
+    }, checked);
+    
+    TaskGraph::Node solve = graph.Add([&]() {
+        parts.resize((rank + DECRYPT_GRAIN - 1) / DECRYPT_GRAIN);
         
-        cout << "Gaussian Elimination (CPU): " << ns_double.count() << " ns." << endl;
-    }
+        // decrypt the log files, and check the MACs, a range of entries into its part of the output.
+        // line 27
+        auto decrypt = [&, this](int first, const XorType<L> *ci) {
+            decrypts.Run([&, this, first, ci]() {
+                int last = min(first + DECRYPT_GRAIN, rank);
+                std::string &part = parts[first / DECRYPT_GRAIN];
+                part.reserve((size_t)(last - first) * 64);
+                
+                keys.Walk(first, last, [&](int i, const KEY_TYPE &key) {
+                    Keys ks;
+                    KeySchedule::Derive(key, ks);
+                    
+                    // decrypt the log message, check wether it has been tampered, and append its logs.
+                    // line 29, 30
+                    decryptLog<L>(ks.EncKey, ci[i], part);
+                });
+            });
+        };
+        // the back substitution finalizes c from the last entry, the ranges are started from the last one, as soon as
+        // their first entry is final.
+        int next = (rank - 1) / DECRYPT_GRAIN * DECRYPT_GRAIN;
+        PlainGaussHelper::FinalizedRow<L> finalized = [&](int first, const XorType<L> *ci) {
+            for (; next >= first; next -= DECRYPT_GRAIN) {
+                decrypt(next, ci);
+            }
+        };
+        
+        // the plan, metal or CPU:
+        if (planned) {
+            auto t1 = high_resolution_clock::now();
+            // the row operations of the recorded solve, the cipher text vector c replaces v
+            // line 27
+            plan.Execute<L>(v.Slots(), finalized);
+            auto t2 = high_resolution_clock::now();
+            
+            duration<long, std::nano> ns_double = t2 - t1;
+            
+            cout << "Gaussian Elimination (Solve Plan): " << ns_double.count() << " ns." << endl;
+        } else if (ctx->useMetal) {
+            auto t1 = high_resolution_clock::now();
+            GaussianElimination<L> ge (M, v);
+            // solve gauss, the cipher text vector c replaces v
+            // line 27
+            ge.solve(finalized);
+            auto t2 = high_resolution_clock::now();
+            
+            duration<long, std::nano> ns_double = t2 - t1;
+            
+            cout << "Gaussian Elimination (Metal): " << ns_double.count() << " ns." << endl;
+        } else {
+            auto t1 = high_resolution_clock::now();
+            // solve gauss, the cipher text vector c replaces v
+            // line 27
+            PlainGaussHelper::Solve<L>(M, v.Slots(), false, finalized, recording ? &plan : nullptr);
+            auto t2 = high_resolution_clock::now();
+            
+            duration<long, std::nano> ns_double = t2 - t1;
+            
+            cout << "Gaussian Elimination (CPU): " << ns_double.count() << " ns." << endl;
+            // M is not needed by the decryption. With metal, the solver takes over its data.
+            delete M;
+        }
+    }, {apply});
     
-    std::ofstream resultLogFile(resultPath, std::ios::app);
-    // Check if the file is successfully opened
-    if (!resultLogFile.is_open()) {
-        std::cerr << "ERROR: opening the result file!" << std::endl;
-        exit(EXIT_FAILURE);
+    // the recorded plan is written next to the decryption.
+    if (!planPath.empty()) {
+        graph.Add([&]() {
+            if (recording && plan.Dropped()) {
+                // a plan of an earlier M would only be loaded again.
+                std::filesystem::remove(planPath);
+                cout << "The solve plan " << planPath << " exceeds its share of the memory budget, it is not recorded." << endl;
+            } else if (recording && plan.Save(planPath)) {
+                cout << "Wrote the solve plan " << planPath << "." << endl;
+            }
+        }, {solve});
     }
     
-    // decrypt the log files, and check the MACs.
-    // line 27
-    for (int i = 0; i < rank; ++i) {
-        // decrypt the log message
-        //line 29
-        string log = decryptLog(keys[i].EncKey, c[i]);
+    // write the decrypted entries in order, once all of them are done.
+    graph.Add([&]() {
+        decrypts.Wait();
         
-        // check wether the log message has been tampered.
-        // line 30
-        if (log == "") {
-            continue;
+        ResultWriter resultLogFile(resultPath);
+        for (size_t first = 0; first < parts.size(); first += DECRYPT_BATCH / DECRYPT_GRAIN) {
+            size_t last = min(parts.size(), first + DECRYPT_BATCH / DECRYPT_GRAIN);
+            std::string batch;
+            size_t size = 0;
+            
+            for (size_t p = first; p < last; ++p) {
+                size += parts[p].size();
+            }
+            batch.reserve(size);
+            for (size_t p = first; p < last; ++p) {
+                batch += parts[p];
+                std::string().swap(parts[p]);
+            }
+            resultLogFile.Push(std::move(batch));
         }
-        // write the log into the desired file.
-        resultLogFile << log << endl;
-     }
+        resultLogFile.Close();
+    }, {solve});
     
-    resultLogFile.close();
+    graph.Run();
     return res;
 }
 
-string Verifier::decryptLog(KEY_TYPE key, XOR_TYPE encLogMessage)
+template<int L>
+void Verifier::decryptLog(const KEY_TYPE &key, const XorType<L> &encLogMessage, std::string &out)
 {
-    array<unsigned char, IV_SIZE> iv;
-    array<unsigned char, MESSAGE_LEN> ciphertext;
-    array<unsigned char, MESSAGE_LEN> logm{0};
-    array<unsigned char, MAC_LEN> mac, referenceMAC;
+    // IV | ciphertext | MAC, read in place. The C functions only read their inputs.
+    unsigned char *iv = const_cast<unsigned char*>(encLogMessage.data());
+    unsigned char *ciphertext = iv + IV_SIZE;
+    const unsigned char *mac = ciphertext + L;
+    unsigned char *k = const_cast<unsigned char*>(key.data());
+    array<unsigned char, L> logm;
+    array<unsigned char, MAC_LEN> referenceMAC;
     size_t macLen, len;
     
-    
-    copy_n(encLogMessage.begin(), IV_SIZE, iv.begin());
-    copy_n(encLogMessage.begin() + IV_SIZE, MESSAGE_LEN, ciphertext.begin());
-    copy_n(encLogMessage.begin() + IV_SIZE + MESSAGE_LEN, MAC_LEN, mac.begin());
-    
-    
-    CMAC(key.data(), ciphertext.data(), MESSAGE_LEN, referenceMAC.data(), &macLen, MAC_LEN);
+    CMAC(k, ciphertext, L, referenceMAC.data(), &macLen, MAC_LEN);
     
     if (macLen != MAC_LEN) {
         cerr << "ERROR: Creating MAC failed." << endl;
         exit(EXIT_FAILURE);
     }
     
-    if (mac != referenceMAC){
+    if (0 != memcmp(mac, referenceMAC.data(), MAC_LEN)){
         // TODO: improve messageing:
         cerr << "Invalid MAC detected: ..." << endl;
-        return "";
+        return;
     }
     
-    if (MESSAGE_LEN != (len = AES_256_CTR_decrypt
-                        (ciphertext.data(), MESSAGE_LEN, key.data(), iv.data(), logm.data()))) {
+    if (L != (len = AES_256_CTR_decrypt(ciphertext, L, k, iv, logm.data()))) {
         cerr << "ERROR: Log encryption failed." << endl;
         exit(EXIT_FAILURE);
     }
-    // Return log.
-    std::string s(logm.data(), std::find(logm.begin(), logm.end(), '\0'));
-    return s;
+    // Append the records of a packed entry.
+    const unsigned char *records[PACK_MAX_RECORDS];
+    size_t lengths[PACK_MAX_RECORDS];
+    int count = UnpackMessage(logm.data(), L, records, lengths);
+    if (count > 0) {
+        for (int i = 0; i < count; ++i) {
+            out.append(reinterpret_cast<const char*>(records[i]), lengths[i]);
+            out += '\n';
+        }
+        return;
+    }
+    
+    // Append log.
+    const unsigned char *end = std::find(logm.data(), logm.data() + L, '\0');
+    if (end == logm.data()) {
+        return;
+    }
+    out.append(reinterpret_cast<const char*>(logm.data()), end - logm.data());
+    out += '\n';
 }
 
 
@@ -13,9 +13,17 @@
 #include <string.h>
 #include <vector>
 #include <array>
+#include <fstream>
 
 #include "Result.hpp"
 #include "PITypes.hpp"
+#include "LogFileView.hpp"
+#include "ThreadPool.hpp"
+
+#define KEY_CHUNK 1024 // entries per task of the key chain, and of the tag checks.
+#define PAD_REMOVAL_GRAIN 64 // slots per task of the pad removal, their pad is generated at once.
+#define DECRYPT_BATCH 16384 // entries per write of the result file.
+#define DECRYPT_GRAIN 256 // entries per task of the decryption.
 
 
 typedef std::basic_string<unsigned char> ustring;
@@ -30,29 +38,75 @@ namespace PI {
         /*
          * Function: Verify
          * ----------------
-         * Verifies the provided log file.
+         * Verifies the provided log file. If the directory holds manifests, the listed segments are verified, each
+         * with its own master key. As many segments are verified at once as fit into the memory budget, their logs
+         * are written in the logging order, and a result per segment is reported.
          */
         Result Verify();
     private:
         PI::VerifierContext *ctx; // the current context
+        PI::ThreadPool pool; // runs the CPU heavy passes.
         /*
          * Function: decryptLog
          * --------------------
-         * Decrypts the provided log message.
+         * Decrypts the provided log message of the message len L, and appends its messages to out, one line each:
+         * a single one, several ones for a packed entry (see UnpackMessage), or none if the MAC is invalid.
+         * Thread safe.
          */
-        std::string decryptLog (KEY_TYPE key, XOR_TYPE encLogMessage);
+        template<int L>
+        void decryptLog (const KEY_TYPE &key, const XorType<L> &encLogMessage, std::string &out);
         /*
          * Function: getAllLogFiles
-         * not part of this thesis!
-         * will only work with a single log file.
+         * --------------------------
+         * Returns all files of the directory with the given extension.
          */
         std::vector<std::string> getAllLogFiles(const std::string& directoryPath, const std::string& extension);
+        /*
+         * Function: readManifest
+         * ----------------------
+         * Returns the segments listed in the manifest, in their logging order.
+         * The master keys are located in keyDirectory.
+         */
+        std::vector<Segment> readManifest(const std::string& manifestPath, const std::string& keyDirectory);
+        /*
+         * Function: planSegment
+         * ---------------------
+         * Reads the layout of the segment, and estimates its peak memory and runtime.
+         */
+        SegmentPlan planSegment(const Segment &segment, size_t index);
+        /*
+         * Function: partPath, appendPart
+         * ------------------------------
+         * The result of the index-th segment is written to its own part, which is appended to the result once all
+         * earlier ones are.
+         */
+        std::string partPath(size_t index);
+        void appendPart(const std::string &partPath, const std::string &resultPath);
+        /*
+         * Function: readLogFileLayout
+         * ---------------------------
+         * Reads the layout, n and m from the header of the log file, a log file without a header has the legacy
+         * layout, and m follows from n. Exits if the header has been tampered.
+         */
+        void readLogFileLayout(const LogFileView &logFile, KEY_TYPE &k0, LogFileLayout &layout, int &n, int &m);
         /*
          * Function: verifySingleLogFile
          * -----------------------------
-         * verifies the provided log file.
+         * verifies the provided log file, which holds up to n entries. The layout, n and m are taken from the
+         * header of the log file, a log file without a header has the legacy layout.
+         */
+        Result verifySingleLogFile(std::string path, std::string resultPath, std::string masterKeyPath, int n);
+        /*
+         * Function: verifyLogFile
+         * -----------------------
+         * verifies the mapped log file with the message len L and Kn slots per entry, its slots are read in
+         * place. verifyLogFileWithK dispatches on the k of the layout. cachePath is the key cache of the log file,
+         * empty without one (see KeyCache), planPath likewise its solve plan (see SolvePlan).
          */
-        Result verifySingleLogFile(std::string path, std::string resultPath);
+        template<int L>
+        Result verifyLogFileWithK(LogFileView &logFile, std::string resultPath, std::string cachePath, std::string planPath, KEY_TYPE k0, const LogFileLayout &layout, int n, int m);
+        template<int L, int Kn>
+        Result verifyLogFile(LogFileView &logFile, std::string resultPath, std::string cachePath, std::string planPath, KEY_TYPE k0, const LogFileLayout &layout, int n, int m);
         /*
          * Function: readMasterKey
          * -----------------------------
@@ -10,6 +10,7 @@
 #define PITypes_hpp
 
 #include <string>
+#include <array>
 extern "C" {
     #include "Crypto.h"
     #include "PIShared.h"
@@ -24,8 +25,35 @@ namespace PI {
         int n; // max number of log entries.
         int m; // log file length.
         bool useMetal; // indicator to use GPU oder CPU
+        int threads; // number of threads of the verifier, 0 for all cores.
+        size_t memoryBudget; // bytes, which the log files verified at once may take, 0 for half of the physical memory.
+        int keyInterval; // every keyInterval-th key of the chain is kept, the others are evolved again (see KeySchedule).
+        std::string keyCache; // directory of the key caches of the log files, empty without caching (see KeyCache).
+        std::string solvePlan; // directory of the solve plans of the log files, empty without them (see SolvePlan).
     } VerifierContext;
     
+    /*
+     a single log file, with its own master key.
+     */
+    typedef struct _Segment {
+        std::string logFilePath; // path of the encrypted log file.
+        std::string masterKeyPath; // path of its master key.
+        int n; // max number of log entries.
+    } Segment;
+    
+    /*
+     a log file, planned for verification (see Verifier::planSegment).
+     */
+    typedef struct _SegmentPlan {
+        Segment segment;
+        size_t index; // position in the logging order.
+        LogFileLayout layout;
+        int n; // max number of log entries, as recorded in the header.
+        int m; // number of slots.
+        size_t memory; // estimated peak memory in bytes.
+        double cost; // estimated relative runtime.
+    } SegmentPlan;
+    
     typedef std::array<unsigned char, KEY_SIZE> KEY_TYPE;
     typedef struct _Keys{
         KEY_TYPE Key;
@@ -35,26 +63,31 @@ namespace PI {
         KEY_TYPE IDKey;
     } Keys;
     
-    typedef struct _KeyStoreEntry{
-        Keys Ki;
-        int i;
-        int lj;
-    } KeyStoreEntry;
-    
     // define types for the requiered byte arrays
     typedef std::array<unsigned char, ID_LEN> ID_TYPE;
     typedef std::array<unsigned char, INTEGRITY_TAG_LEN> TAG_TYPE;
-    typedef std::array<unsigned char, CIPHERTEXT_LEN> XOR_TYPE;
+    // the XOR part of a slot, for a log file with the message len L (see LogFileLayout).
+    template<int L> using XorType = std::array<unsigned char, CIPHERTEXT_LEN_OF(L)>;
+    typedef XorType<MESSAGE_LEN> XOR_TYPE;
     typedef std::array<unsigned char, MESSAGE_LEN> LOG_MESSAGE_TYPE;
     /*
      struct that holds one "line" of the log.
      */
-    typedef struct _Tau_i {
-        XOR_TYPE XOR;
+    template<int L> struct TauType {
+        XorType<L> XOR;
         TAG_TYPE T;
         ID_TYPE ID;
-    } Tau_i;
+    };
+    typedef TauType<MESSAGE_LEN> Tau_i;
     
+/*
+ every valid message len (IsValidMessageLen), the verifier is instantiated for each of them. The XOR part of a slot
+ is a whole number of ulong4 for each of them, which the Metal kernels rely on.
+ */
+#define FOR_EACH_MESSAGE_LEN(X) X(128) X(256) X(512) X(1024) X(2048) X(4096)
+// every valid k (IsValidRedundancy), the loops over the slots of an entry are unrolled for each of them.
+#define FOR_EACH_K(X) X(3) X(4) X(5) X(6) X(7) X(8)
+
 }
 
 
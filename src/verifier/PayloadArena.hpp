@@ -0,0 +1,69 @@
+//
+//  PayloadArena.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef PayloadArena_hpp
+#define PayloadArena_hpp
+
+#include <span>
+#include <cstdlib>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "PITypes.hpp"
+
+namespace PI {
+    /*
+     the payloads of a verification, one XOR part of the message len L per slot, in a single anonymous mapping.
+     The pad is removed into it, the solve reduces and substitutes it in place, and the entries are decrypted straight
+     out of it, so it is the only copy of the payloads. Page aligned and sized, the GPU shares it without a copy, and
+     pages of slots which are never written (null slots) are never touched.
+     */
+    template<int L>
+    class PayloadArena {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * maps count zeroed XOR parts. Exits if the memory can not be mapped.
+         */
+        PayloadArena(size_t count) : count(count) {
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size = (count * sizeof(XorType<L>) + page - 1) / page * page;
+            if (size == 0) {
+                size = page;
+            }
+
+            void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED) {
+                perror("mmap");
+                exit(EXIT_FAILURE);
+            }
+            data = static_cast<XorType<L>*>(mapping);
+        }
+        ~PayloadArena() {
+            munmap(data, size);
+        }
+        PayloadArena(const PayloadArena&) = delete;
+        PayloadArena& operator=(const PayloadArena&) = delete;
+
+        // the XOR parts, indexed by slot.
+        std::span<XorType<L>> Slots() const { return std::span<XorType<L>>(data, count); }
+        XorType<L> &operator[](size_t i) const { return data[i]; }
+
+        // the mapping, Size is a multiple of the page size.
+        void *Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        XorType<L> *data = nullptr;
+        size_t count;
+        size_t size = 0; // length of the mapping.
+    };
+}
+
+#endif /* PayloadArena_hpp */
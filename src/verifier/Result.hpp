@@ -12,6 +12,8 @@
 typedef struct {
     int code;
     bool success;
+    int entries = 0; // number of recovered log entries (the rank).
+    int tamperedSlots = 0; // number of slots, which have been tampered.
 } Result;
 
 #endif /* Result_h */
@@ -0,0 +1,70 @@
+//
+//  ResultWriter.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "ResultWriter.hpp"
+#include <iostream>
+
+using namespace PI;
+
+ResultWriter::ResultWriter(const std::string &path): file(path, std::ios::app | std::ios::binary) {
+    // Check if the file is successfully opened
+    if (!file.is_open()) {
+        std::cerr << "ERROR: opening the result file!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    writer = std::thread(&ResultWriter::writerLoop, this);
+}
+
+ResultWriter::~ResultWriter() {
+    Close();
+}
+
+void ResultWriter::Push(std::string &&batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return batches.size() < RESULT_WRITER_QUEUE_DEPTH; });
+    batches.push_back(std::move(batch));
+    changed.notify_all();
+}
+
+void ResultWriter::Close() {
+    if (!writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    writer.join();
+
+    file.close();
+    if (failed || file.fail()) {
+        std::cerr << "ERROR: writing the result file!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void ResultWriter::writerLoop() {
+    for (;;) {
+        std::string batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]() { return closing || !batches.empty(); });
+            if (batches.empty()) {
+                return;
+            }
+            batch = std::move(batches.front());
+            batches.pop_front();
+        }
+        changed.notify_all();
+
+        if (!file.write(batch.data(), batch.size())) {
+            failed = true;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+//
+//  ResultWriter.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef ResultWriter_hpp
+#define ResultWriter_hpp
+
+#include <string>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define RESULT_WRITER_QUEUE_DEPTH 2 // batches waiting for the writer, a full queue blocks Push.
+
+namespace PI {
+    /*
+     appends the decrypted logs to the result file on its own thread, one large write per batch, in the order the
+     batches are pushed.
+     */
+    class ResultWriter {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * opens the result file at path for appending. Exits if it can not be opened.
+         */
+        ResultWriter(const std::string &path);
+        ~ResultWriter();
+        ResultWriter(const ResultWriter&) = delete;
+        ResultWriter& operator=(const ResultWriter&) = delete;
+
+        /*
+         * Function: Push
+         * --------------
+         * queues the batch for writing, blocks while RESULT_WRITER_QUEUE_DEPTH batches are waiting.
+         */
+        void Push(std::string &&batch);
+
+        /*
+         * Function: Close
+         * ---------------
+         * writes the remaining batches and closes the result file. Exits if a write failed.
+         */
+        void Close();
+
+    private:
+        std::ofstream file;
+        std::deque<std::string> batches;
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool closing = false;
+        bool failed = false;
+        std::thread writer;
+
+        // helper function:
+        // writes the batches, until the writer is closed and the queue is empty.
+        void writerLoop();
+    };
+}
+
+#endif /* ResultWriter_hpp */
@@ -0,0 +1,285 @@
+//
+//  SolvePlan.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "SolvePlan.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+using namespace PI;
+
+// magic(8) version(4) m(8) rank(8) K(4) steps(8) shape(32) IV(16) MAC(16).
+#define SOLVE_PLAN_SHAPE_OFFSET 40
+#define SOLVE_PLAN_IV_OFFSET 72
+#define SOLVE_PLAN_MAC_OFFSET 88
+// the steps are read, en- or decrypted, authenticated and written in pieces.
+#define SOLVE_PLAN_PIECE (1 << 20)
+
+static_assert(sizeof(SolveStep) == 12, "a step is stored as three 32 bit words");
+static_assert(SOLVE_PLAN_PIECE % AES_BLOCK_LEN == 0, "a piece has to be a whole number of AES blocks");
+
+static const char planLabel[] = "PI solve plan";
+
+// helper function:
+// writes the value big endian.
+static void putUint(unsigned char *buffer, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; --i) {
+        buffer[i] = (unsigned char)value;
+        value >>= 8;
+    }
+}
+
+// helper function:
+// reads a big endian value.
+static uint64_t getUint(const unsigned char *buffer, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i) {
+        value = value << 8 | buffer[i];
+    }
+    return value;
+}
+
+// helper function:
+// dst ^= src, 16 bytes at a time (SSE2 or NEON, whichever the target has). len is a multiple of 16.
+static inline void xorRow(unsigned char *dst, const unsigned char *src, size_t len) {
+    typedef unsigned char Block __attribute__((vector_size(16)));
+
+    for (size_t i = 0; i < len; i += sizeof(Block)) {
+        Block x, y;
+        memcpy(&x, dst + i, sizeof(Block));
+        memcpy(&y, src + i, sizeof(Block));
+        x ^= y;
+        memcpy(dst + i, &x, sizeof(Block));
+    }
+}
+
+SolvePlan::SolvePlan(const KEY_TYPE &masterKey, size_t maxSteps) : maxSteps(maxSteps) {
+    unsigned char keys[2 * KEY_SIZE];
+    unsigned char label[sizeof(planLabel)];
+
+    // the keys of the plan are independent of the key chain of the log file.
+    std::copy_n(planLabel, sizeof(planLabel), label);
+    if (0 == PRF(label, sizeof(planLabel), const_cast<unsigned char*>(masterKey.data()), keys, sizeof(keys))) {
+        std::cerr << "Error: Failed to derive the keys of the solve plan." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::copy_n(keys, KEY_SIZE, encKey.begin());
+    std::copy_n(keys + KEY_SIZE, KEY_SIZE, macKey.begin());
+}
+
+std::string SolvePlan::PathOf(const std::string &directory, const std::string &logFilePath) {
+    return (std::filesystem::path(directory) / std::filesystem::path(logFilePath).filename()).string() + SOLVE_PLAN_EXTENSION;
+}
+
+bool SolvePlan::Load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[SOLVE_PLAN_HEADER_LEN];
+    unsigned char expected[MAC_LEN];
+    size_t macLen;
+
+    if (!file.read(reinterpret_cast<char*>(header), SOLVE_PLAN_HEADER_LEN) || 0 != memcmp(header, SOLVE_PLAN_MAGIC, 8)
+        || getUint(header + 8, 4) != SOLVE_PLAN_VERSION) {
+        return false;
+    }
+    uint64_t count = getUint(header + 32, 8);
+    std::error_code error;
+    if (count > maxSteps || count > (std::filesystem::file_size(path, error) - SOLVE_PLAN_HEADER_LEN) / sizeof(SolveStep) || error) {
+        return false;
+    }
+
+    // decrypt the steps while they are authenticated, they are only kept if the MAC matches.
+    std::vector<unsigned char> piece(SOLVE_PLAN_PIECE);
+    std::array<unsigned char, IV_SIZE> counter;
+    CMACContext mac;
+    std::copy_n(header + SOLVE_PLAN_IV_OFFSET, IV_SIZE, counter.begin());
+    if (1 != CMACInit(&mac, const_cast<unsigned char*>(macKey.data())) || 1 != CMACUpdate(&mac, header, SOLVE_PLAN_MAC_OFFSET)) {
+        std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    steps.resize(count);
+    unsigned char *plain = reinterpret_cast<unsigned char*>(steps.data());
+    size_t len = count * sizeof(SolveStep);
+    for (size_t offset = 0; offset < len; offset += SOLVE_PLAN_PIECE) {
+        size_t size = std::min<size_t>(SOLVE_PLAN_PIECE, len - offset);
+
+        if (!file.read(reinterpret_cast<char*>(piece.data()), size)) {
+            CMACFree(&mac);
+            steps.clear();
+            return false;
+        }
+        if (1 != CMACUpdate(&mac, piece.data(), size)) {
+            std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        crypt(piece.data(), size, counter, plain + offset);
+    }
+    if (1 != CMACFinal(&mac, expected, &macLen, MAC_LEN) || macLen != MAC_LEN) {
+        std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (0 != memcmp(expected, header + SOLVE_PLAN_MAC_OFFSET, MAC_LEN)) {
+        steps.clear();
+        return false;
+    }
+
+    m = (int)getUint(header + 12, 8);
+    rank = (int)getUint(header + 20, 8);
+    k = (int)getUint(header + 28, 4);
+    std::copy_n(header + SOLVE_PLAN_SHAPE_OFFSET, DIGEST_LEN, shape.begin());
+    return true;
+}
+
+bool SolvePlan::Bind(int m, int rank, int k, const std::vector<int> &owned) {
+    std::array<unsigned char, DIGEST_LEN> digest;
+
+    if (1 != Digest(reinterpret_cast<const unsigned char*>(owned.data()), owned.size() * sizeof(int), digest.data())) {
+        std::cerr << "ERROR: Creating the shape of M failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!steps.empty() && m == this->m && rank == this->rank && k == this->k && digest == shape) {
+        return true;
+    }
+
+    this->m = m;
+    this->rank = rank;
+    this->k = k;
+    shape = digest;
+    steps.clear();
+    dropped = false;
+    return false;
+}
+
+bool SolvePlan::Save(const std::string &path) const {
+    unsigned char header[SOLVE_PLAN_HEADER_LEN];
+    std::vector<unsigned char> piece(SOLVE_PLAN_PIECE);
+    std::array<unsigned char, IV_SIZE> counter;
+    CMACContext mac;
+    size_t macLen;
+
+    encodeHeader(header);
+    if (1 != GenerateIV(header + SOLVE_PLAN_IV_OFFSET)) {
+        std::cerr << "ERROR: Creating the IV of the solve plan failed." << std::endl;
+        return false;
+    }
+    std::copy_n(header + SOLVE_PLAN_IV_OFFSET, IV_SIZE, counter.begin());
+    if (1 != CMACInit(&mac, const_cast<unsigned char*>(macKey.data())) || 1 != CMACUpdate(&mac, header, SOLVE_PLAN_MAC_OFFSET)) {
+        std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // an incomplete plan is never moved in place. The MAC is written once all steps are.
+    std::string temp = path + ".tmp";
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(header), SOLVE_PLAN_HEADER_LEN);
+
+    const unsigned char *plain = reinterpret_cast<const unsigned char*>(steps.data());
+    size_t len = steps.size() * sizeof(SolveStep);
+    for (size_t offset = 0; offset < len && file; offset += SOLVE_PLAN_PIECE) {
+        size_t size = std::min<size_t>(SOLVE_PLAN_PIECE, len - offset);
+
+        crypt(plain + offset, size, counter, piece.data());
+        if (1 != CMACUpdate(&mac, piece.data(), size)) {
+            std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        file.write(reinterpret_cast<const char*>(piece.data()), size);
+    }
+    if (1 != CMACFinal(&mac, header + SOLVE_PLAN_MAC_OFFSET, &macLen, MAC_LEN) || macLen != MAC_LEN) {
+        std::cerr << "ERROR: Creating the MAC of the solve plan failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    file.seekp(SOLVE_PLAN_MAC_OFFSET);
+    file.write(reinterpret_cast<const char*>(header + SOLVE_PLAN_MAC_OFFSET), MAC_LEN);
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Could not write the solve plan " << temp << "." << std::endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+    if (rename(temp.c_str(), path.c_str()) == -1) {
+        perror("Could not move the solve plan in place");
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+template<int L>
+void SolvePlan::Execute(std::span<XorType<L>> v, const PlainGaussHelper::FinalizedRow<L> &finalized) const {
+    for (const SolveStep &step : steps) {
+        switch (step.code) {
+            case SOLVE_STEP_SWAP:
+                std::swap(v[step.a], v[step.b]);
+                break;
+            case SOLVE_STEP_XOR:
+                xorRow(v[step.a].data(), v[step.b].data(), CIPHERTEXT_LEN_OF(L));
+                break;
+            case SOLVE_STEP_COPY:
+                v[step.a] = v[step.b];
+                break;
+            case SOLVE_STEP_ZERO:
+                std::fill(v[step.a].begin(), v[step.a].end(), 0);
+                break;
+            case SOLVE_STEP_FINAL:
+                if (finalized) {
+                    finalized((int)step.a, v.data());
+                }
+                break;
+        }
+    }
+}
+
+void SolvePlan::encodeHeader(unsigned char *header) const {
+    memset(header, 0, SOLVE_PLAN_HEADER_LEN);
+    memcpy(header, SOLVE_PLAN_MAGIC, 8);
+    putUint(header + 8, SOLVE_PLAN_VERSION, 4);
+    putUint(header + 12, m, 8);
+    putUint(header + 20, rank, 8);
+    putUint(header + 28, k, 4);
+    putUint(header + 32, steps.size(), 8);
+    std::copy(shape.begin(), shape.end(), header + SOLVE_PLAN_SHAPE_OFFSET);
+}
+
+bool SolvePlan::grow() {
+    if (dropped) {
+        return false;
+    }
+    if (steps.size() >= maxSteps) {
+        // the plan would take more than its share of the memory budget.
+        dropped = true;
+        std::vector<SolveStep>().swap(steps);
+        return false;
+    }
+    steps.reserve(std::min(maxSteps, std::max<size_t>(1024, steps.capacity() * 2)));
+    return true;
+}
+
+void SolvePlan::crypt(const unsigned char *in, size_t len, std::array<unsigned char, IV_SIZE> &counter, unsigned char *out) const {
+    // the C function only reads its inputs, a piece fits into its int.
+    if ((int)len != AES_256_CTR_encrypt(const_cast<unsigned char*>(in), (int)len, const_cast<unsigned char*>(encKey.data()), counter.data(), out)) {
+        std::cerr << "ERROR: Encrypting the solve plan failed." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // add the blocks of the piece to the big endian 128 bit counter, only the last piece is not a whole number of them.
+    uint64_t blocks = len / AES_BLOCK_LEN;
+    for (int i = IV_SIZE - 1; i >= 0 && blocks != 0; --i) {
+        uint64_t sum = counter[i] + (blocks & 0xff);
+        counter[i] = (unsigned char)sum;
+        blocks = (blocks >> 8) + (sum >> 8);
+    }
+}
+
+// instantiate the plan for every message len.
+#define INSTANTIATE_MESSAGE_LEN(L) \
+template void SolvePlan::Execute<L>(std::span<XorType<L>> v, const PlainGaussHelper::FinalizedRow<L> &finalized) const;
+FOR_EACH_MESSAGE_LEN(INSTANTIATE_MESSAGE_LEN)
+#undef INSTANTIATE_MESSAGE_LEN
@@ -0,0 +1,140 @@
+//
+//  SolvePlan.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef SolvePlan_hpp
+#define SolvePlan_hpp
+
+#include <string>
+#include <vector>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <algorithm>
+#include "PITypes.hpp"
+#include "gaussian-elimination/PlainGaussHelper.hpp"
+
+#define SOLVE_PLAN_MAGIC "PISOLVEP"
+#define SOLVE_PLAN_VERSION 1
+#define SOLVE_PLAN_EXTENSION ".solveplan"
+#define SOLVE_PLAN_HEADER_LEN 104 // followed by the encrypted steps.
+#define SOLVE_PLAN_BUDGET_SHARE 4 // a plan takes at most 1 / share of the memory budget.
+
+namespace PI {
+    // the row operations of a solve on the vectors v.
+    enum SolveStepCode : uint32_t {
+        SOLVE_STEP_SWAP = 0, // swap v[a] and v[b].
+        SOLVE_STEP_XOR = 1, // v[a] ^= v[b].
+        SOLVE_STEP_COPY = 2, // v[a] = v[b].
+        SOLVE_STEP_ZERO = 3, // v[a] = 0.
+        SOLVE_STEP_FINAL = 4, // the solution from a on is final (see PlainGaussHelper::FinalizedRow).
+    };
+
+    typedef struct _SolveStep {
+        uint32_t code;
+        uint32_t a;
+        uint32_t b;
+    } SolveStep;
+
+    /*
+     the row operations, which the CPU solver applies to the vectors v of a log file. M only depends on which slots
+     every entry owns, so its shape follows from the master key, m, k and the rank of an untampered log file. A plan
+     recorded by one solve of it, solves every later verification of it, without building or reducing M.
+     The shape is recorded as the digest of the owned locations. The steps are encrypted (AES-256-CTR), and the plan is
+     authenticated as a whole (CMAC), under two keys derived from the master key.
+     The fill-in of the reduction makes a plan large (about m * rank / 4 steps of 12 bytes), a plan of more than
+     maxSteps steps is neither recorded nor loaded.
+     */
+    class SolvePlan {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * an empty plan for the log file of the master key, of up to maxSteps steps (see MaxSteps). Exits if the keys of
+         * the plan can not be derived.
+         */
+        SolvePlan(const KEY_TYPE &masterKey, size_t maxSteps);
+
+        // returns: the steps a plan may take within the memory budget in bytes.
+        static size_t MaxSteps(size_t budget) { return budget / SOLVE_PLAN_BUDGET_SHARE / sizeof(SolveStep); }
+
+        // returns: the estimated bytes of the plan of a log file with m slots and n entries, within the budget.
+        static size_t Memory(int n, int m, size_t budget) {
+            return std::min((size_t)m * n / 4, MaxSteps(budget)) * sizeof(SolveStep);
+        }
+
+        // returns: the path of the plan of the log file at logFilePath, within the directory.
+        static std::string PathOf(const std::string &directory, const std::string &logFilePath);
+
+        /*
+         * Function: Load
+         * --------------
+         * reads the plan at path.
+         * returns: false if there is no plan, it has more than maxSteps steps, or it has been modified.
+         */
+        bool Load(const std::string &path);
+
+        /*
+         * Function: Bind
+         * --------------
+         * binds the plan to M with m rows and rank columns, whose column i has a 1 in the rows owned[i * k + j] which
+         * are not negative.
+         * returns: true if the loaded plan solves M. Otherwise the plan is emptied, to record the solve of M.
+         */
+        bool Bind(int m, int rank, int k, const std::vector<int> &owned);
+
+        /*
+         * Function: Save
+         * --------------
+         * writes the plan to path, under a temporary name which is moved in place. Prints and returns false on a
+         * failure.
+         */
+        bool Save(const std::string &path) const;
+
+        // appends a step, while the plan is recorded. Past maxSteps steps the plan is dropped, see Dropped.
+        void Record(SolveStepCode code, int a, int b = 0) {
+            if (steps.size() == steps.capacity() && !grow()) {
+                return;
+            }
+            steps.push_back({code, (uint32_t)a, (uint32_t)b});
+        }
+
+        /*
+         * Function: Execute
+         * -----------------
+         * applies the steps to v in order, afterwards its first rank entries hold the solution c. finalized is called
+         * at the same points as by the back substitution. Instantiated for FOR_EACH_MESSAGE_LEN.
+         */
+        template<int L>
+        void Execute(std::span<XorType<L>> v, const PlainGaussHelper::FinalizedRow<L> &finalized = nullptr) const;
+
+        size_t Steps() const { return steps.size(); }
+        // returns: true if the recorded plan has been dropped, for having more than maxSteps steps.
+        bool Dropped() const { return dropped; }
+
+    private:
+        int m = 0, rank = 0, k = 0;
+        std::array<unsigned char, DIGEST_LEN> shape {};
+        std::vector<SolveStep> steps;
+        size_t maxSteps;
+        bool dropped = false;
+        KEY_TYPE encKey {};
+        KEY_TYPE macKey {};
+
+        // helper function:
+        // encodes the header up to its IV.
+        void encodeHeader(unsigned char *header) const;
+        // helper function:
+        // makes room for more steps, up to maxSteps. Drops the plan, and returns false, once it is full.
+        bool grow();
+        // helper function:
+        // en- or decrypts a piece of the steps at the counter, and advances it. The CTR mode is its own inverse.
+        void crypt(const unsigned char *in, size_t len, std::array<unsigned char, IV_SIZE> &counter, unsigned char *out) const;
+    };
+}
+
+#endif /* SolvePlan_hpp */
@@ -0,0 +1,51 @@
+//
+//  TaskGraph.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "TaskGraph.hpp"
+
+using namespace PI;
+
+TaskGraph::Node TaskGraph::Add(std::function<void()> task, const std::vector<Node> &dependencies) {
+    Node node = tasks.size();
+    Task &t = tasks.emplace_back();
+
+    t.task = std::move(task);
+    t.pending = dependencies.size();
+    for (Node dependency : dependencies) {
+        tasks[dependency].successors.push_back(node);
+    }
+    return node;
+}
+
+void TaskGraph::Run() {
+    TaskGroup group(pool);
+    std::vector<Node> roots;
+
+    // collected first, a started task may already bring the pending count of its successors to 0.
+    for (Node node = 0; node < tasks.size(); ++node) {
+        if (tasks[node].pending == 0) {
+            roots.push_back(node);
+        }
+    }
+    for (Node node : roots) {
+        start(group, node);
+    }
+    group.Wait();
+}
+
+void TaskGraph::start(TaskGroup &group, Node node) {
+    group.Run([this, &group, node]() {
+        tasks[node].task();
+
+        for (Node successor : tasks[node].successors) {
+            if (tasks[successor].pending.fetch_sub(1) == 1) {
+                start(group, successor);
+            }
+        }
+    });
+}
@@ -0,0 +1,63 @@
+//
+//  TaskGraph.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef TaskGraph_hpp
+#define TaskGraph_hpp
+
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include "ThreadPool.hpp"
+
+namespace PI {
+    /*
+     tasks with explicit dependencies, run on a pool. A task is started once all tasks it depends on are done, tasks
+     without a path between them may run at the same time.
+     */
+    class TaskGraph {
+    public:
+        typedef size_t Node;
+
+        TaskGraph(ThreadPool &pool): pool(pool) {}
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        /*
+         * Function: Add
+         * -------------
+         * adds the task, which depends on the given nodes. Has to be called before Run.
+         *
+         * returns: the node of the task.
+         */
+        Node Add(std::function<void()> task, const std::vector<Node> &dependencies = {});
+
+        /*
+         * Function: Run
+         * -------------
+         * runs all tasks, and returns once all of them are done.
+         */
+        void Run();
+
+    private:
+        struct Task {
+            std::function<void()> task;
+            std::atomic<size_t> pending {0}; // dependencies, which are not done yet.
+            std::vector<Node> successors;
+        };
+
+        ThreadPool &pool;
+        std::deque<Task> tasks; // stable references, while tasks are added.
+
+        // helper function:
+        // runs the node, and starts its successors which are ready after it.
+        void start(TaskGroup &group, Node node);
+    };
+}
+
+#endif /* TaskGraph_hpp */
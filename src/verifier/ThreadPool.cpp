@@ -0,0 +1,143 @@
+//
+//  ThreadPool.cpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+using namespace PI;
+
+// the pool and the queue of a worker thread.
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads < 1) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, (size_t)i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    Queue &queue = *queues[self()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    // taking the lock orders the wakeup after the check of a thread going to sleep.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+size_t ThreadPool::self() const {
+    return currentPool == this ? currentQueue : 0;
+}
+
+bool ThreadPool::runOne(size_t queue) {
+    std::function<void()> task;
+
+    for (size_t i = 0; i < queues.size() && !task; ++i) {
+        Queue &victim = *queues[(queue + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        // the own queue from the back, the queues of the others from the front.
+        if (i == 0) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        } else {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    queued.fetch_sub(1);
+    task();
+    return true;
+}
+
+void ThreadPool::WaitUntil(const std::function<bool()> &done, bool help) {
+    size_t queue = self();
+
+    help = help || workers.empty();
+    while (!done()) {
+        if (help && runOne(queue)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&]() { return done() || (help && queued.load() > 0); });
+    }
+}
+
+void ThreadPool::Notify() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+}
+
+void ThreadPool::workerLoop(size_t queue) {
+    currentPool = this;
+    currentQueue = queue;
+
+    for (;;) {
+        if (runOne(queue)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskGroup::Run(std::function<void()> task) {
+    ThreadPool *pool = &this->pool;
+
+    pending.fetch_add(1);
+    pool->Submit([this, pool, task = std::move(task)]() {
+        task();
+        // the group may be gone once pending is 0, only the pool is used after it.
+        if (pending.fetch_sub(1) == 1) {
+            pool->Notify();
+        }
+    });
+}
+
+void TaskGroup::Wait() {
+    pool.WaitUntil([this]() { return pending.load() == 0; });
+}
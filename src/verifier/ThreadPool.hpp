@@ -0,0 +1,117 @@
+//
+//  ThreadPool.hpp
+//  verifier
+//
+//  Copyright © 2023 Airbus Commercial Aircraft
+//  Created by Florian on 19.10.26.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace PI {
+    /*
+     a fixed number of worker threads, which share the CPU heavy tasks of the verifier. Every thread has its own queue,
+     it runs its newest task first, an idle thread steals the oldest task of another queue. A thread waiting for a
+     TaskGroup runs tasks as well, so tasks may wait for other tasks.
+     */
+    class ThreadPool {
+    public:
+        /*
+         * Contructor
+         * ----------
+         * starts threads - 1 workers, the waiting thread is the last one. threads < 1 uses all available cores.
+         */
+        ThreadPool(int threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // returns: the number of threads, including the waiting one.
+        int Size() const { return (int)workers.size() + 1; }
+
+        /*
+         * Function: Submit
+         * ----------------
+         * queues the task on the queue of the calling thread, a thread outside of the pool uses the first queue.
+         */
+        void Submit(std::function<void()> task);
+
+        /*
+         * Function: WaitUntil
+         * -------------------
+         * runs tasks of the pool, until done returns true. done is checked again after every task, and after every
+         * call of Notify. Without help, the calling thread only sleeps, which needs at least one worker.
+         */
+        void WaitUntil(const std::function<bool()> &done, bool help = true);
+
+        // wakes the threads in WaitUntil, after their condition may have changed.
+        void Notify();
+
+    private:
+
+        // a queue of a thread, the first one is shared by the threads outside of the pool.
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queued {0}; // tasks in all queues.
+        std::mutex sleepMutex;
+        std::condition_variable wake; // a task has been queued, or a condition of WaitUntil has changed.
+        bool stopping = false;
+
+        // helper function:
+        // returns: the queue of the calling thread.
+        size_t self() const;
+        // helper function:
+        // runs the newest task of the own queue, or steals the oldest task of another one. Returns false if all are empty.
+        bool runOne(size_t queue);
+        // helper function:
+        // runs the tasks of the worker, until the pool is destroyed.
+        void workerLoop(size_t queue);
+    };
+
+    /*
+     a set of tasks on a pool, which can be waited for.
+     */
+    class TaskGroup {
+    public:
+        TaskGroup(ThreadPool &pool): pool(pool) {}
+        // waits for the remaining tasks.
+        ~TaskGroup() { Wait(); }
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        /*
+         * Function: Run
+         * -------------
+         * submits the task to the pool, as part of this group. Can be called from a task of the group.
+         */
+        void Run(std::function<void()> task);
+
+        /*
+         * Function: Wait
+         * --------------
+         * runs tasks of the pool, until all tasks of this group are done.
+         */
+        void Wait();
+
+    private:
+        ThreadPool &pool;
+        std::atomic<size_t> pending {0};
+    };
+}
+
+#endif /* ThreadPool_hpp */
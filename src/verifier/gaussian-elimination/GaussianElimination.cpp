@@ -10,6 +10,7 @@
 #include "PlainGaussHelper.hpp"
 #include <iostream>
 #include <chrono>
+#include <string.h>
 
 using std::chrono::high_resolution_clock;
 using std::chrono::duration;
@@ -19,14 +20,16 @@ using namespace std;
 #define IS_ONE(var,pos) ((var) & (1<<(pos)))
 
 namespace Gauss{
-    GaussianElimination::GaussianElimination(BMatrixType *M, std::vector<PI::XOR_TYPE> v, bool debugPrints)
+    template<int L>
+    GaussianElimination<L>::GaussianElimination(BMatrixType *M, PI::PayloadArena<L> &v, bool debugPrints)
         :_m(*M), I(BMatrixType::I(M->rows)), _v(v), _debug(debugPrints)
     {
         // get GPU
         MTL::Device *device = MTL::CreateSystemDefaultDevice();
         
         // Create Metal Factory, this class handles all the metall realted code.
-        _factory = new MetalFactory(device);
+        // The kernels are specialised for the ciphertext len, in ulong4.
+        _factory = new MetalFactory(device, CIPHERTEXT_LEN_OF(L) / sizeof(unsigned long[4]));
         
         // Create all necessary buffers, fill them with data
         prepareData();
@@ -37,12 +40,12 @@ namespace Gauss{
         
     }
     
-    void GaussianElimination::prepareData()
+    template<int L>
+    void GaussianElimination<L>::prepareData()
     {
         int mSize = _m.rows * _m.buckets * SIZE_OF_BUCKET;
         
-        // Convert C++ std stuff into plain C
-        size_t vSize = _v.size() * CIPHERTEXT_LEN;
+        size_t vSize = (size_t)_m.rows * CIPHERTEXT_LEN_OF(L);
         
         // Buffer that can be pre filled:
         _mBuffer            = _factory->newBuffer(_m.data, mSize);
@@ -52,7 +55,7 @@ namespace Gauss{
         _bucketsBuffer      = _factory->newBuffer(&_m.buckets, sizeof(int));
         _bucketsIBuffer        = _factory->newBuffer(&(I->buckets), sizeof(int));
         
-        _xorsBuffer            = _factory->newBuffer(_v.data(), vSize); // holds the initial values of the vector v
+        _xorsBuffer            = _factory->newBufferNoCopy(_v.Data(), _v.Size()); // holds the initial values of the vector v
         
         
         // Buffer that cant be pre filled, because they change for every call:
@@ -61,13 +64,13 @@ namespace Gauss{
         _currentRowBuffer   = _factory->newBuffer(sizeof(int));
         // or will be used for return values
         _indexResultBuffer  = _factory->newBuffer(sizeof(int));
-        _cBuffer            = _factory->newBuffer(vSize);
         _vBuffer            = _factory->newBuffer(vSize); // holds the result after bookkepping
     }
     
     
     
-    void GaussianElimination::sendXORComputeCommand(int &currentRow/*, int currentBucket*/)
+    template<int L>
+    void GaussianElimination<L>::sendXORComputeCommand(int &currentRow/*, int currentBucket*/)
     {
         // +1 because we dont need to do something with the current row, no xor here.
         int size = _m.rows - (currentRow +1);
@@ -92,7 +95,8 @@ namespace Gauss{
         _factory->sendCommand(_factory->XorPSO, buffers, 7, size, false);
     }
     
-    int GaussianElimination::sendPartitialPivotComputeCommand(int currentRow, int currentCol)
+    template<int L>
+    int GaussianElimination<L>::sendPartitialPivotComputeCommand(int currentRow, int currentCol)
     {
         int size = _m.rows - (currentRow +1);
         
@@ -121,7 +125,8 @@ namespace Gauss{
     
     
     
-    void GaussianElimination::gaussForwardReduction()
+    template<int L>
+    void GaussianElimination<L>::gaussForwardReduction()
     {
         int null_col_counter = 0;
         int *current_row;
@@ -164,7 +169,8 @@ namespace Gauss{
         }
     }
     
-    std::vector<PI::XOR_TYPE> GaussianElimination::sendBookkeepingCommand() {
+    template<int L>
+    void GaussianElimination<L>::sendBookkeepingCommand() {
         MTL::Buffer *buffers [] = {
             _iBuffer,
             _rowsBuffer, // the number of rows in M is eqvivalent to the size of the indentity Matrix I
@@ -177,25 +183,16 @@ namespace Gauss{
         //std::cout << (*(int*)_bucketsIBuffer->contents()) << std::endl;
         _factory->sendCommand(_factory->BookkeepingPSO, buffers, 5, I->rows, true);
         
-        auto size = _v.size();
-        std::vector<PI::XOR_TYPE> v(size, PI::XOR_TYPE{});
-        
-        // get the result of the bookkeeping kernel:
-        unsigned char *vBuffer = (unsigned char *)_vBuffer->contents();
-        
-        for (int i = 0; i < size; ++i) {
-            PI::XOR_TYPE ciphertext;
-            // copy xor array
-            for (int j = 0; j < CIPHERTEXT_LEN; ++j) {
-                ciphertext[j] = vBuffer[i * CIPHERTEXT_LEN + j];
-            }
-            v[i] = ciphertext;
+        // the result of the bookkeeping kernel replaces v in the arena, the kernel is done reading it.
+        memcpy(_v.Data(), _vBuffer->contents(), (size_t)_m.rows * CIPHERTEXT_LEN_OF(L));
+        if (_vBuffer != nullptr) {
+            _vBuffer->release();
         }
-        
-        return v;
+        _vBuffer = nullptr;
     }
     
-    std::vector<PI::XOR_TYPE> GaussianElimination::solve()
+    template<int L>
+    void GaussianElimination<L>::solve(const PlainGaussHelper::FinalizedRow<L> &finalized)
     {
         // forward reduction
         auto t1 = high_resolution_clock::now();
@@ -211,7 +208,7 @@ namespace Gauss{
         printMatrixes();
         // apply bookkeeping
         auto t3 = high_resolution_clock::now();
-        std::vector<PI::XOR_TYPE> v_afterBookkeeping = sendBookkeepingCommand();
+        sendBookkeepingCommand();
         auto t4 = high_resolution_clock::now();
         
         duration<long, std::nano> ns_double_book = t4 - t3;
@@ -223,17 +220,16 @@ namespace Gauss{
         
         // Back Substitution
         auto t5 = high_resolution_clock::now();
-        std::vector<PI::XOR_TYPE> c = PlainGaussHelper::BackSubstitution(_m, v_afterBookkeeping);
+        PlainGaussHelper::BackSubstitution<L>(_m, _v.Slots(), finalized);
         auto t6 = high_resolution_clock::now();
         
         duration<long, std::nano> ns_double_back = t6 - t5;
         
         cout << "Gaussian Elimination (Back Substitution): " << ns_double_back.count() << " ns." << endl;
-        
-        return c;
     }
     
-    void GaussianElimination::printMatrixes() {
+    template<int L>
+    void GaussianElimination<L>::printMatrixes() {
 #ifdef DEBUG
         if (!_debug) {
             return;
@@ -242,7 +238,8 @@ namespace Gauss{
         I->Print();
 #endif
     }
-    void GaussianElimination::println(std::string s)
+    template<int L>
+    void GaussianElimination<L>::println(std::string s)
     {
 #ifdef DEBUG
         if (!_debug) {
@@ -253,7 +250,8 @@ namespace Gauss{
 #endif
     }
     
-    GaussianElimination::~GaussianElimination()
+    template<int L>
+    GaussianElimination<L>::~GaussianElimination()
     {
         // TDOO: release all pointers!!
         // others:
@@ -262,7 +260,6 @@ namespace Gauss{
         
         // buffers:
         _mBuffer->release();
-        _cBuffer->release();
         _xorsBuffer->release();
         _iBuffer->release();
         _bucketsIBuffer->release();
@@ -271,12 +268,15 @@ namespace Gauss{
         _rowsBuffer->release();
         _bucketsBuffer->release();
         _indexResultBuffer->release();
-        _vBuffer->release();
+        if (_vBuffer != nullptr) {
+            _vBuffer->release();
+        }
     }
     
-    int GaussianElimination::RankOf(BMatrixType &m) {
-        for (int r = m.rows; r > 0; --r) {
-            for (int c = m.colsInBits; c >= r; --c) {
+    template<int L>
+    int GaussianElimination<L>::RankOf(BMatrixType &m) {
+        for (int r = m.rows - 1; r >= 0; --r) {
+            for (int c = m.colsInBits - 1; c >= r; --c) {
                 if (m(r,c)) {
                     return r+1;
                 }
@@ -285,4 +285,9 @@ namespace Gauss{
         
         return  0;
     }
+    
+    // instantiate the solver for every message len.
+#define INSTANTIATE_MESSAGE_LEN(L) template class GaussianElimination<L>;
+    FOR_EACH_MESSAGE_LEN(INSTANTIATE_MESSAGE_LEN)
+#undef INSTANTIATE_MESSAGE_LEN
 }
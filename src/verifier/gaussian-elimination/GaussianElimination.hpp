@@ -14,22 +14,30 @@
 #include "../Matrix.hpp"
 #include "MetalFactory.hpp"
 #include "../PITypes.hpp"
+#include "PlainGaussHelper.hpp"
+#include "../PayloadArena.hpp"
 
 using namespace Matrix;
 
 namespace Gauss {
+    /*
+     solves the SLE for vectors of the message len L, instantiated for FOR_EACH_MESSAGE_LEN. The vectors stay in the
+     arena v, which the GPU reads without a copy, and are replaced by the solution c.
+     */
+    template<int L>
     class GaussianElimination {
     public:
-        GaussianElimination(BMatrixType *M, std::vector<PI::XOR_TYPE> v, bool debugPrints = false);
+        GaussianElimination(BMatrixType *M, PI::PayloadArena<L> &v, bool debugPrints = false);
         
         MetalFactory *_factory;
         
         ~GaussianElimination();
         /*
          * Function: solve
-         * solves the provided SLE, using metal.
+         * solves the provided SLE, using metal, c is left in the first M->colsInBits vectors of the arena.
+         * finalized is called as the back substitution finalizes c (see PlainGaussHelper::FinalizedRow).
          */
-        std::vector<PI::XOR_TYPE> solve();
+        void solve(const PlainGaussHelper::FinalizedRow<L> &finalized = nullptr);
         void gaussForwardReduction();
         
     private:
@@ -44,20 +52,19 @@ namespace Gauss {
         MTL::Buffer *_bucketsBuffer; // number of all columns of  the matrix m
         MTL::Buffer *_bucketsIBuffer; // number of buckets of the identity matrix for bookkeeping
         MTL::Buffer *_indexResultBuffer; // the pivot index result
-        MTL::Buffer *_cBuffer; // holding the vector c after the system is solved.
-        MTL::Buffer *_xorsBuffer; // holding the result of the Bookkeeping
-        MTL::Buffer *_vBuffer;
+        MTL::Buffer *_xorsBuffer; // the vector v, shares the memory of the arena.
+        MTL::Buffer *_vBuffer; // holding the result of the Bookkeeping, until it is copied into the arena.
         
         int sendPartitialPivotComputeCommand(int currentRow, int currentCol);
         void sendXORComputeCommand(int &currentRow/*, int currentCol*/);
-        std::vector<PI::XOR_TYPE> sendBookkeepingCommand();
+        void sendBookkeepingCommand();
         void prepareData();
         //void swapRows(MatrixType &m, int l, int k, BMatrixType &I);
         void printMatrixes();
         void println(std::string s);
         BMatrixType _m;
         BMatrixType *I;
-        std::vector<PI::XOR_TYPE> _v;
+        PI::PayloadArena<L> &_v;
         bool _debug;
         /*
          This method works only if the matrix m is in upper triangle form.
@@ -10,11 +10,12 @@
 
 using namespace metal;
 
-#define MESSAGE_LEN 1024 // The max len of an log entry message.#define AES_BLOCK_LEN 16
+#define AES_BLOCK_LEN 16
 #define IV_SIZE 16
 #define MAC_LEN 16 // Encrypt then MAC HMAC len. ??CMAC??
 
-#define CIPHERTEXT_LEN 33//((IV_SIZE + MESSAGE_LEN + MAC_LEN) / (4*8)) // chars to long4 or (16+16+1024)/(4*8)
+// the ciphertext len in ulong4 ((IV_SIZE + message len + MAC_LEN) / (4*8)), set by the MetalFactory for the log file.
+constant uint CIPHERTEXT_LEN [[function_constant(0)]];
 
 #define GET_BUCKET(col) ((col) / B_BITS)
 
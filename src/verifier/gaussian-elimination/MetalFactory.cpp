@@ -13,8 +13,9 @@
 #include <math.h>
 
 namespace Gauss{
-    MetalFactory::MetalFactory(MTL::Device *device) {
+    MetalFactory::MetalFactory(MTL::Device *device, unsigned int cipherLen) {
         _device = device;
+        _cipherLen = cipherLen;
         
         // Load the shader files with a .metal file extension in the project
         MTL::Library *defaultLibrary = _device->newDefaultLibrary();
@@ -63,17 +64,22 @@ namespace Gauss{
     }
     
     void MetalFactory::loadFunctions(MTL::Library *lib) {
-        XorPSO = getPSO(lib, "xor_row");
-        PivotPSO = getPSO(lib, "partial_pivoting");
-        BookkeepingPSO = getPSO(lib, "bookkeeping");
+        // the ciphertext len of the log file is a compile time constant of the kernels.
+        MTL::FunctionConstantValues *constants = MTL::FunctionConstantValues::alloc()->init();
+        constants->setConstantValue(&_cipherLen, MTL::DataTypeUInt, NS::UInteger(0));
+        
+        XorPSO = getPSO(lib, "xor_row", constants);
+        PivotPSO = getPSO(lib, "partial_pivoting", constants);
+        BookkeepingPSO = getPSO(lib, "bookkeeping", constants);
+        constants->release();
     }
     
-    MTL::ComputePipelineState *MetalFactory::getPSO(MTL::Library *lib, std::string funName) {
+    MTL::ComputePipelineState *MetalFactory::getPSO(MTL::Library *lib, std::string funName, MTL::FunctionConstantValues *constants) {
         NS::Error *error = nullptr;
         auto str = NS::String::string(funName.data(), NS::ASCIIStringEncoding);
         
         // Create Functions
-        MTL::Function *fun = lib->newFunction(str);
+        MTL::Function *fun = lib->newFunction(str, constants, &error);
         if (fun == nullptr) {
             std::cerr << "Failed to find the " << fun << " function." << std::endl;
             exit(EXIT_FAILURE);
@@ -134,6 +140,12 @@ namespace Gauss{
         return _device->newBuffer(pointer, size, MTL::ResourceStorageModeShared);
     }
     
+    MTL::Buffer *MetalFactory::newBufferNoCopy(void *pointer, size_t size)
+    {
+        // the memory is owned by the caller, and outlives the buffer.
+        return _device->newBuffer(pointer, size, MTL::ResourceStorageModeShared, nullptr);
+    }
+    
     void MetalFactory::setBufferWithUInt32(MTL::Buffer *buffer, uint32_t data)
     {
         uint32_t *bufferPtr = (uint32_t*)buffer->contents();
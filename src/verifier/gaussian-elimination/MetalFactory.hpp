@@ -15,18 +15,24 @@ namespace Gauss {
     class MetalFactory {
         MTL::Device *_device;
         MTL::CommandQueue *_queue; // The command queue used to pass commands to the device.
+        unsigned int _cipherLen; // ciphertext len in ulong4.
         
         
         void encodeComand(MTL::ComputePipelineState *pso, MTL::ComputeCommandEncoder *encoder, const MTL::Buffer * const buffers[], int size, unsigned int threadCount, bool useMaxThreadGroupSize);
         
-        MTL::ComputePipelineState *getPSO(MTL::Library *lib, std::string funname);
+        MTL::ComputePipelineState *getPSO(MTL::Library *lib, std::string funname, MTL::FunctionConstantValues *constants);
         void loadFunctions(MTL::Library *lib);
         
     public:
-        MetalFactory(MTL::Device *device);
+        /*
+         * cipherLen: the ciphertext len in ulong4, the kernels are specialised for it (function constant 0).
+         */
+        MetalFactory(MTL::Device *device, unsigned int cipherLen);
         ~MetalFactory();
         MTL::Buffer *newBuffer(size_t size);
         MTL::Buffer *newBuffer(const void *pointer, size_t size);
+        // shares the memory at pointer with the device instead of copying it, pointer and size have to be page aligned.
+        MTL::Buffer *newBufferNoCopy(void *pointer, size_t size);
         void sendCommand(MTL::ComputePipelineState *pso, const MTL::Buffer * const buffers[], int size, unsigned int threadCount, bool useMaxThreadGroupSize);
         
         
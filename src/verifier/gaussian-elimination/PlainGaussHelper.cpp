@@ -7,6 +7,7 @@
 //
 
 #include "PlainGaussHelper.hpp"
+#include "../SolvePlan.hpp"
 #include <chrono>
 
 using std::chrono::high_resolution_clock;
@@ -16,12 +17,25 @@ using namespace std;
 namespace PlainGaussHelper {
     void print(BMatrixType &M, bool debug);
     
-    std::vector<PI::XOR_TYPE> Solve(BMatrixType *M, std::vector<PI::XOR_TYPE> &v, bool debug) {
-        BMatrixType *I = BMatrixType::I(M->rows);
+    // helper function:
+    // XORs the vector src onto dst.
+    template<int L>
+    inline void xorInto(PI::XorType<L> &dst, const PI::XorType<L> &src) {
+        const size_t ulongSize = sizeof(unsigned long);
+        constexpr size_t ulongLen = CIPHERTEXT_LEN_OF(L) / ulongSize;
+        auto* dstAsUlong = reinterpret_cast<unsigned long*>(dst.data());
+        auto* srcAsUlong = reinterpret_cast<const unsigned long*>(src.data());
         
+        for (size_t i = 0; i < ulongLen; ++i) {
+            dstAsUlong[i] ^= srcAsUlong[i];
+        }
+    }
+    
+    template<int L>
+    void Solve(BMatrixType *M, std::span<PI::XorType<L>> v, bool debug, const FinalizedRow<L> &finalized, PI::SolvePlan *plan) {
         print(*M, debug);
         auto t1 = high_resolution_clock::now();
-        ForwardReduction(M, I);
+        ForwardReduction<L>(M, v, plan);
         auto t2 = high_resolution_clock::now();
         duration<long, std::nano> ns_double = t2 - t1;
         
@@ -31,24 +45,16 @@ namespace PlainGaussHelper {
         
         std::cout << "Detected Rank: " << std::to_string(RankOf(*M)) << std::endl;
         
-        auto t3 = high_resolution_clock::now();
-        std::vector<PI::XOR_TYPE> _v = ApplyBookkeeping(*I, v);
-        auto t4 = high_resolution_clock::now();
-        duration<long, std::nano> ns_double_book = t4 - t3;
-        
-        cout << "Gaussian Elimination (Bookkeeping): " << ns_double_book.count() << " ns." << endl;
-        delete I;
-        
         auto t5 = high_resolution_clock::now();
-        std::vector<PI::XOR_TYPE> c = BackSubstitution(*M, _v);
+        BackSubstitution<L>(*M, v, finalized, plan);
         auto t6 = high_resolution_clock::now();
         duration<long, std::nano> ns_double_back = t6 - t5;
         
         cout << "Gaussian Elimination (Back Substitution): " << ns_double_back.count() << " ns." << endl;
-        return c;
     }
     
-    void ForwardReduction(BMatrixType *M, BMatrixType *I){
+    template<int L>
+    void ForwardReduction(BMatrixType *M, std::span<PI::XorType<L>> v, PI::SolvePlan *plan){
         int null_col_counter = 0;
         int current_row = 0;
         
@@ -64,7 +70,10 @@ namespace PlainGaussHelper {
             
             if (new_pivot_index != current_row) {
                 M->swapRows(current_row, new_pivot_index);
-                I->swapRows(current_row, new_pivot_index);
+                std::swap(v[current_row], v[new_pivot_index]);
+                if (plan) {
+                    plan->Record(PI::SOLVE_STEP_SWAP, current_row, new_pivot_index);
+                }
             }
             
             for (int row = current_row + 1; row < M->rows; ++row) {
@@ -82,9 +91,10 @@ namespace PlainGaussHelper {
                     M->data[index] = M->data[index] ^ M->data[current_row * M->buckets + c];
                 }
                 
-                for (int c = 0; c < I->buckets; ++c) {
-                    int index = row * I->buckets + c;
-                    I->data[index] = I->data[index] ^ I->data[current_row * I->buckets + c];
+                // the same row operation on v.
+                xorInto<L>(v[row], v[current_row]);
+                if (plan) {
+                    plan->Record(PI::SOLVE_STEP_XOR, row, current_row);
                 }
             }
             
@@ -92,84 +102,74 @@ namespace PlainGaussHelper {
         }
     }
     
-    
-    std::vector<PI::XOR_TYPE> ApplyBookkeeping(BMatrixType &I, std::vector<PI::XOR_TYPE> &v) {
-        std::vector<PI::XOR_TYPE> _v(I.rows, PI::XOR_TYPE{});
-        const size_t ulongSize = sizeof(unsigned long);
-        const size_t ulongLen = CIPHERTEXT_LEN / ulongSize;
+    template<int L>
+    void BackSubstitution(BMatrixType &M, std::span<PI::XorType<L>> v, const FinalizedRow<L> &finalized, PI::SolvePlan *plan) {
+        const int cols = M.colsInBits;
+        std::vector<int> pivots; // the pivot column of every row, up to the rank.
+        std::vector<char> isPivot(cols, 0);
         
-        for (int row = 0; row < I.rows; ++row) {
-            
-            for (int col = 0; col < I.colsInBits; ++col) {
-                if (I(row, col)) {
-                    auto* vRowAsUlong = reinterpret_cast<unsigned long*>(v[col].data());
-                    auto* _vRowAsUlong = reinterpret_cast<unsigned long*>(_v[row].data());
-
-                    // XOR
-                    for (int i = 0; i < ulongLen; ++i) {
-                        _vRowAsUlong[i] ^= vRowAsUlong[i];
-                    }
-                }
+        // the pivot of a row is its first 1, right of the pivot of the row above.
+        for (int row = 0; row < min(M.rows, cols); ++row) {
+            int col = pivots.empty() ? row : max(row, pivots.back() + 1);
+            while (col < cols && !M(row, col)) {
+                ++col;
+            }
+            if (col == cols) {
+                break; // all further rows are 0.
             }
+            pivots.push_back(col);
+            isPivot[col] = 1;
         }
+        const int rank = (int)pivots.size();
+        int final = cols; // the first final c, recorded whenever it moves.
         
-        return _v;
-    }
-    
-    std::vector<PI::XOR_TYPE> BackSubstitution(BMatrixType &M, std::vector<PI::XOR_TYPE> &v) {
-        std::vector<PI::XOR_TYPE> ci (M.colsInBits, PI::XOR_TYPE{});
-        const size_t ulongSize = sizeof(unsigned long);
-        const size_t ulongLen = CIPHERTEXT_LEN / ulongSize;
-        
-        
-        // we skip the rows which contains no cs
-        for (int r = 0; r < M.colsInBits; ++r) {
-            int row = M.colsInBits -1 -r; // use main diagonal (start at the main diagonal)(-1 one because we are starting at index 0 and colsInBits is the a number start counting at 1)
-            
-                                // It is not needed to check further than the main diagonal, (the matrix is overdetermined that why we sometimes check over the main diagonal)
-            
-            
-            // The first element should be the 1 in the main diagonal, this is the single new entry which is unknown, and has to be taken from the vector v.
-            // in some cases it is possible that there is a 0 at the main diagonal, thats why we are looping till we found the first 1, starting at the main diagonal.
-            
-             // begin at the diagonal.
-            int col;
-            for (col = row; col < M.colsInBits; ++col) {
-                if (M(row, col)) {
-                    // Reinterpret as unsigned long arrays for XOR
-                    auto* vColAsUlong = reinterpret_cast<unsigned long*>(v[col].data());
-                    auto* ciRowAsUlong = reinterpret_cast<unsigned long*>(ci[row].data());
-
-                    
-                    for (int i = 0; i < ulongLen; ++i) {
-                        ciRowAsUlong[i] ^= vColAsUlong[i]; // The first vector will be taken from the original v
+        // from the last row, c[pivot] is the v of its row, with the already known c right of the pivot removed.
+        // The rows are processed from the last one, c[pivot] is written to the index of the pivot, which is at least
+        // the row, so the v of the rows above are never overwritten.
+        for (int row = cols - 1; row >= 0; --row) {
+            if (row < rank) {
+                int pivot = pivots[row];
+                
+                // XORing it with the already known c, will remove all the vectors, that have been combined with it.
+                for (int col = pivot + 1; col < cols; ++col) {
+                    if (M(row, col)) {
+                        xorInto<L>(v[row], v[col]);
+                        if (plan) {
+                            plan->Record(PI::SOLVE_STEP_XOR, row, col);
+                        }
                     }
-                    col++;
-                    break; // we found the first Vektor now get the rest out of th c_results
                 }
-            }
-            
-            // XORing it with the current state of c_i, will remove all the vectors, that have been combined with it.
-            for (; col < M.colsInBits; ++col) {
-                if (M(row, col)) { // Check if there is a 1 at this index, and if so XOR the vector at this index on c_i
-                    // Reinterpret as unsigned long arrays for XOR
-                    auto* ciColAsUlong = reinterpret_cast<unsigned long*>(ci[col].data());
-                    auto* ciRowAsUlong = reinterpret_cast<unsigned long*>(ci[row].data());
-
-                    
-                    for (int i = 0; i < ulongLen; ++i) {
-                        ciRowAsUlong[i] ^= ciColAsUlong[i]; // XOR with already know vectors, to unpeel the current.
+                if (pivot != row) {
+                    v[pivot] = v[row];
+                    if (plan) {
+                        plan->Record(PI::SOLVE_STEP_COPY, pivot, row);
                     }
                 }
             }
+            // a column without pivot is not determined by the system.
+            if (!isPivot[row]) {
+                std::fill(v[row].begin(), v[row].end(), 0);
+                if (plan) {
+                    plan->Record(PI::SOLVE_STEP_ZERO, row);
+                }
+            }
+            
+            // the c from row on are final, except the pivots of the rows above.
+            int above = min(row, rank);
+            int first = above == 0 ? row : max(row, pivots[above - 1] + 1);
+            if (finalized) {
+                finalized(first, v.data());
+            }
+            if (plan && first < final) {
+                plan->Record(PI::SOLVE_STEP_FINAL, first);
+                final = first;
+            }
         }
-        
-        return ci;
     }
     
     int RankOf(BMatrixType &m) {
-        for (int r = m.rows; r > 0; --r) {
-            for (int c = m.colsInBits; c >= r; --c) {
+        for (int r = m.rows - 1; r >= 0; --r) {
+            for (int c = m.colsInBits - 1; c >= r; --c) {
                 if (m(r,c)) {
                     return r+1;
                 }
@@ -184,4 +184,12 @@ namespace PlainGaussHelper {
             M.Print();
         }
     }
+    
+    // instantiate the solver for every message len.
+#define INSTANTIATE_MESSAGE_LEN(L) \
+    template void Solve<L>(BMatrixType *M, std::span<PI::XorType<L>> v, bool debug, const FinalizedRow<L> &finalized, PI::SolvePlan *plan); \
+    template void ForwardReduction<L>(BMatrixType *M, std::span<PI::XorType<L>> v, PI::SolvePlan *plan); \
+    template void BackSubstitution<L>(BMatrixType &M, std::span<PI::XorType<L>> v, const FinalizedRow<L> &finalized, PI::SolvePlan *plan);
+    FOR_EACH_MESSAGE_LEN(INSTANTIATE_MESSAGE_LEN)
+#undef INSTANTIATE_MESSAGE_LEN
 }
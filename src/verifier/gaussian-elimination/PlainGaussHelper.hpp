@@ -10,13 +10,28 @@
 #define PlainGaussHelper_hpp
 
 #include <stdio.h>
+#include <functional>
+#include <span>
 #include "../Matrix.hpp"
 #include "../PITypes.hpp"
 
 using namespace Matrix;
 
+namespace PI {
+    class SolvePlan;
+}
+
 namespace PlainGaussHelper {
-    std::vector<PI::XOR_TYPE> Solve(BMatrixType *M, std::vector<PI::XOR_TYPE> &v, bool debug = false);
+    // called during the back substitution, whenever more of the solution c is final. c is the data of the solved
+    // vector, its entries from first on do not change anymore. first only decreases, the last call is with 0.
+    template<int L>
+    using FinalizedRow = std::function<void(int first, const PI::XorType<L> *c)>;
+    
+    // the vectors are of the message len L, instantiated for FOR_EACH_MESSAGE_LEN.
+    // v is reduced and substituted in place, afterwards its first M->colsInBits entries hold the solution c.
+    // Every row operation on v is recorded into the plan, if there is one (see PI::SolvePlan).
+    template<int L>
+    void Solve(BMatrixType *M, std::span<PI::XorType<L>> v, bool debug = false, const FinalizedRow<L> &finalized = nullptr, PI::SolvePlan *plan = nullptr);
     inline int Pivot(BMatrixType *M, int &currentRow, int &currentCol) {
         for (int i = currentRow; i < M->rows; ++i) {
             if ((*M)(i, currentCol)) {
@@ -25,9 +40,12 @@ namespace PlainGaussHelper {
         }
         return -1;
     }
-    void ForwardReduction(BMatrixType *M, BMatrixType *I);
-    std::vector<PI::XOR_TYPE> ApplyBookkeeping(BMatrixType &I, std::vector<PI::XOR_TYPE> &v);
-    std::vector<PI::XOR_TYPE> BackSubstitution(BMatrixType &M, std::vector<PI::XOR_TYPE> &v);
+    // applies every row operation on M to v as well, instead of recording them in an identity matrix.
+    template<int L>
+    void ForwardReduction(BMatrixType *M, std::span<PI::XorType<L>> v, PI::SolvePlan *plan = nullptr);
+    // M has to be in row echelon form, the solution replaces v. A column without a pivot is left 0.
+    template<int L>
+    void BackSubstitution(BMatrixType &M, std::span<PI::XorType<L>> v, const FinalizedRow<L> &finalized = nullptr, PI::SolvePlan *plan = nullptr);
     int RankOf(BMatrixType &m);
 }
 
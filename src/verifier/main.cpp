@@ -15,6 +15,7 @@
 #include <iostream>
 #include "PI.hpp"
 #include "Matrix.hpp"
+#include "KeySchedule.hpp"
 #include "gaussian-elimination/GaussianElimination.hpp"
 #include <iomanip>
 #include <sstream>
@@ -46,16 +47,21 @@ int main(int argc, const char * argv[]) {
     
     duration<long, std::nano> ns_double = t2 - t1;
     cout << "Verification process end to end needed: " << ns_double.count() << " ns" << endl;
-    return 0;
+    // a tampered log file fails the verification, also if all entries have been recovered.
+    return result.success ? 0 : EXIT_FAILURE;
 }
 
 static PI::VerifierContext parseCommandLineArguments(int argc, const char * argv[])
 {
     PI::VerifierContext ctx;
     ctx.useMetal = true; // default
+    ctx.threads = 0; // all cores
+    ctx.memoryBudget = 0; // half of the physical memory
+    ctx.keyInterval = 1; // every key
+    ctx.n = 0; // required
     
     // Check if the minimum number of arguments is met
-    if (argc < 9 || argc > 10) {
+    if (argc < 9) {
         std::cerr << "Error: Insufficient number of arguments." << std::endl;
         exit(EXIT_FAILURE);
     }
@@ -104,6 +110,70 @@ static PI::VerifierContext parseCommandLineArguments(int argc, const char * argv
                 std::cerr << "Error: Missing value for -n option." << std::endl;
                 exit(EXIT_FAILURE);
             }
+        } else if (std::string(argv[i]) == "-t" || std::string(argv[i]) == "--threads") {
+            // Check if there is a value following the -t option
+            if (i + 1 < argc) {
+                i++;
+                try {
+                    ctx.threads = std::stoi(argv[i]);
+                } catch (const std::exception& e) {
+                    std::cerr << "Invalid argument for -t: " << e.what() << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            } else {
+                std::cerr << "Error: Missing value for -t option." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::string(argv[i]) == "--memory-budget") {
+            // Check if there is a value following the --memory-budget option
+            if (i + 1 < argc) {
+                i++;
+                try {
+                    ctx.memoryBudget = std::stoul(argv[i]) << 20;
+                } catch (const std::exception& e) {
+                    std::cerr << "Invalid argument for --memory-budget: " << e.what() << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            } else {
+                std::cerr << "Error: Missing value for --memory-budget option." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::string(argv[i]) == "--key-interval") {
+            // Check if there is a value following the --key-interval option
+            if (i + 1 < argc) {
+                i++;
+                try {
+                    ctx.keyInterval = std::stoi(argv[i]);
+                } catch (const std::exception& e) {
+                    std::cerr << "Invalid argument for --key-interval: " << e.what() << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                if (ctx.keyInterval < 1 || ctx.keyInterval > KEY_INTERVAL_MAX || (ctx.keyInterval & (ctx.keyInterval - 1)) != 0) {
+                    std::cerr << "Error: --key-interval has to be a power of two up to " << KEY_INTERVAL_MAX << "." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            } else {
+                std::cerr << "Error: Missing value for --key-interval option." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::string(argv[i]) == "--key-cache") {
+            // Check if there is a value following the --key-cache option
+            if (i + 1 < argc) {
+                i++;
+                ctx.keyCache = argv[i];
+            } else {
+                std::cerr << "Error: Missing value for --key-cache option." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::string(argv[i]) == "--solve-plan") {
+            // Check if there is a value following the --solve-plan option
+            if (i + 1 < argc) {
+                i++;
+                ctx.solvePlan = argv[i];
+            } else {
+                std::cerr << "Error: Missing value for --solve-plan option." << std::endl;
+                exit(EXIT_FAILURE);
+            }
         } else if (std::string(argv[i]) == "--no-metal") {
             ctx.useMetal = false;
         } else {
@@ -112,5 +182,11 @@ static PI::VerifierContext parseCommandLineArguments(int argc, const char * argv
         }
     }
     
+    // the options can be given in any order, and repeated, the last one counts.
+    if (ctx.masterKeyPath.empty() || ctx.logFileDirectory.empty() || ctx.outFile.empty() || ctx.n <= 0) {
+        std::cerr << "Error: The options -k, -l, -o and -n (greater 0) are required." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    
     return ctx;
 }